@@ -0,0 +1,99 @@
+// Micro-benchmark: Graph validity checks vs the bit-parallel PackedGraph ones
+#include "hra_sampler.h"
+
+#define BENCH_GRAPHS 4096
+
+static unsigned long long bench_rng = 88172645463325252ULL;
+
+static unsigned int bench_rand(void) {
+  bench_rng ^= bench_rng << 13;
+  bench_rng ^= bench_rng >> 7;
+  bench_rng ^= bench_rng << 17;
+  return (unsigned int)(bench_rng >> 32);
+}
+
+// Densities vary per graph so every check both passes and fails often
+static void random_graph(Graph *g, int n) {
+  init_graph(g, n);
+  unsigned int density = 10 + bench_rand() % 50;
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+      if (i != j && bench_rand() % 100 < density)
+        add_edge(g, i, j, bench_rand() % 3 == 0);
+}
+
+// Times rounds passes of check over every graph in set, counting passes.
+// A macro rather than a function pointer so the inline packed checks are
+// measured as they are used, without a call per graph.
+#define TIME_CHECK(check, set, rounds, passes, seconds)                        \
+  do {                                                                         \
+    double t0 = wall_time_seconds();                                           \
+    for (int r = 0; r < (rounds); r++)                                         \
+      for (int i = 0; i < BENCH_GRAPHS; i++)                                   \
+        (passes) += check(&(set)[i]);                                          \
+    (seconds) = wall_time_seconds() - t0;                                      \
+  } while (0)
+
+int main(int argc, char *argv[]) {
+  int n = argc > 1 ? atoi(argv[1]) : 5;
+  int rounds = argc > 2 ? atoi(argv[2]) : 500;
+  if (n < 2 || n > MAX_NODES || rounds <= 0) {
+    fprintf(stderr, "Usage: %s [n_nodes 2-%d] [rounds]\n", argv[0],
+            MAX_NODES);
+    return 1;
+  }
+
+  Graph *graphs = malloc(BENCH_GRAPHS * sizeof(Graph));
+  PackedGraph *packed = malloc(BENCH_GRAPHS * sizeof(PackedGraph));
+  if (!graphs || !packed) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return 1;
+  }
+  for (int i = 0; i < BENCH_GRAPHS; i++) {
+    random_graph(&graphs[i], n);
+    graph_to_packed(&graphs[i], &packed[i]);
+  }
+
+  const char *names[] = {"weakly connected", "heritable topology",
+                         "heritable regulatory"};
+  printf("Validity checks, n=%d, %d graphs x %d rounds\n", n, BENCH_GRAPHS,
+         rounds);
+  printf("%-22s %10s %10s %8s %6s\n", "check", "Graph ns", "packed ns",
+         "speedup", "pass%");
+
+  bool agree = true;
+  for (int c = 0; c < 3; c++) {
+    long long pass_graph = 0, pass_packed = 0;
+    double graph_time = 0, packed_time = 0;
+    if (c == 0) {
+      TIME_CHECK(is_weakly_connected, graphs, rounds, pass_graph, graph_time);
+      TIME_CHECK(packed_is_weakly_connected, packed, rounds, pass_packed,
+                 packed_time);
+    } else if (c == 1) {
+      TIME_CHECK(is_heritable_topology, graphs, rounds, pass_graph,
+                 graph_time);
+      TIME_CHECK(packed_is_heritable_topology, packed, rounds, pass_packed,
+                 packed_time);
+    } else {
+      TIME_CHECK(is_heritable_regulatory, graphs, rounds, pass_graph,
+                 graph_time);
+      TIME_CHECK(packed_is_heritable_regulatory, packed, rounds, pass_packed,
+                 packed_time);
+    }
+
+    double calls = (double)rounds * BENCH_GRAPHS;
+    printf("%-22s %10.2f %10.2f %7.1fx %5.1f%%\n", names[c],
+           graph_time * 1e9 / calls, packed_time * 1e9 / calls,
+           packed_time > 0 ? graph_time / packed_time : 0.0,
+           100.0 * pass_packed / calls);
+    if (pass_graph != pass_packed) {
+      fprintf(stderr, "Error: %s disagrees (%lld vs %lld passes)\n",
+              names[c], pass_graph, pass_packed);
+      agree = false;
+    }
+  }
+
+  free(graphs);
+  free(packed);
+  return agree ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+#include "hra_binary.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define HRAB_MAGIC "HRAB"
+#define HRAB_VERSION 1
+
+static void put_le32(uint8_t *p, uint32_t v) {
+  for (int i = 0; i < 4; i++)
+    p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+  uint32_t v = 0;
+  for (int i = 0; i < 4; i++)
+    v |= (uint32_t)p[i] << (8 * i);
+  return v;
+}
+
+static void put_le64(uint8_t *p, uint64_t v) {
+  for (int i = 0; i < 8; i++)
+    p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t get_le64(const uint8_t *p) {
+  uint64_t v = 0;
+  for (int i = 0; i < 8; i++)
+    v |= (uint64_t)p[i] << (8 * i);
+  return v;
+}
+
+static void build_header(uint8_t *hdr, long long count) {
+  memset(hdr, 0, HRAB_HEADER_SIZE);
+  memcpy(hdr, HRAB_MAGIC, 4);
+  put_le32(hdr + 4, HRAB_VERSION);
+  put_le32(hdr + 8, HRAB_RECORD_SIZE);
+  put_le32(hdr + 12, HRAB_MAX_NODES);
+  put_le64(hdr + 16, (uint64_t)count);
+}
+
+// Returns the graph count, or -1 if hdr is not a usable header
+static long long parse_header(const uint8_t *hdr) {
+  if (memcmp(hdr, HRAB_MAGIC, 4) != 0 || get_le32(hdr + 4) != HRAB_VERSION ||
+      get_le32(hdr + 8) != HRAB_RECORD_SIZE ||
+      get_le32(hdr + 12) != HRAB_MAX_NODES)
+    return -1;
+  return (long long)get_le64(hdr + 16);
+}
+
+// True if count records fit after the header in a file of size bytes
+static bool count_fits(long long count, long long size) {
+  return count >= 0 && size >= HRAB_HEADER_SIZE &&
+         count <= (size - HRAB_HEADER_SIZE) / HRAB_RECORD_SIZE;
+}
+
+// allowed[n]: the mask bits of edges between nodes 0..n-1
+static void build_node_masks(uint8_t allowed[][HRAB_MASK_BYTES]) {
+  memset(allowed, 0, (HRAB_MAX_NODES + 1) * HRAB_MASK_BYTES);
+  for (int n = 0; n <= HRAB_MAX_NODES; n++)
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < n; j++) {
+        int bit = i * HRAB_MAX_NODES + j;
+        allowed[n][bit / 8] |= (uint8_t)(1u << (bit % 8));
+      }
+}
+
+// A record readers can decode safely: at most HRAB_MAX_NODES nodes, and
+// edge and label bits only between those nodes, labels only on edges
+static bool record_valid(const HrabRecord *rec,
+                         uint8_t allowed[][HRAB_MASK_BYTES]) {
+  if (rec->n_nodes > HRAB_MAX_NODES)
+    return false;
+  const uint8_t *mask = allowed[rec->n_nodes];
+  for (int b = 0; b < HRAB_MASK_BYTES; b++)
+    if ((rec->edges[b] & ~mask[b]) || (rec->labels[b] & ~rec->edges[b]))
+      return false;
+  return true;
+}
+
+// Record encoding
+void hrab_encode(HrabRecord *rec, int n_nodes, const int *adj, int stride,
+                 int source_id) {
+  memset(rec, 0, sizeof(*rec));
+  rec->n_nodes = (uint8_t)n_nodes;
+  int n_edges = 0;
+  for (int i = 0; i < n_nodes; i++)
+    for (int j = 0; j < n_nodes; j++) {
+      int r = adj[i * stride + j];
+      if (r < 0)
+        continue;
+      int bit = i * HRAB_MAX_NODES + j;
+      rec->edges[bit / 8] |= (uint8_t)(1u << (bit % 8));
+      if (r == 1)
+        rec->labels[bit / 8] |= (uint8_t)(1u << (bit % 8));
+      n_edges++;
+    }
+  rec->n_edges = (uint8_t)n_edges;
+  put_le32(rec->source, (uint32_t)source_id);
+}
+
+int hrab_node_count(const HrabRecord *rec) { return rec->n_nodes; }
+
+int hrab_source(const HrabRecord *rec) {
+  return (int)(int32_t)get_le32(rec->source);
+}
+
+int hrab_edge(const HrabRecord *rec, int from, int to) {
+  int bit = from * HRAB_MAX_NODES + to;
+  if (!(rec->edges[bit / 8] & (1u << (bit % 8))))
+    return -1;
+  return (rec->labels[bit / 8] >> (bit % 8)) & 1;
+}
+
+int hrab_decode_edges(const HrabRecord *rec, int *from, int *to, int *label) {
+  int count = 0;
+  for (int i = 0; i < rec->n_nodes; i++)
+    for (int j = 0; j < rec->n_nodes; j++) {
+      int r = hrab_edge(rec, i, j);
+      if (r < 0)
+        continue;
+      from[count] = i;
+      to[count] = j;
+      label[count] = r;
+      count++;
+    }
+  return count;
+}
+
+// mmap-based reader
+HrabFile *hrab_open(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return NULL;
+  uint8_t hdr[HRAB_HEADER_SIZE];
+  long long count = -1;
+  if (fread(hdr, 1, sizeof(hdr), fp) == sizeof(hdr))
+    count = parse_header(hdr);
+  struct stat st;
+  if (count < 0 || fstat(fileno(fp), &st) != 0 ||
+      !count_fits(count, (long long)st.st_size)) {
+    fclose(fp);
+    return NULL;
+  }
+
+  HrabFile *hf = calloc(1, sizeof(HrabFile));
+  if (!hf) {
+    fclose(fp);
+    return NULL;
+  }
+  hf->count = count;
+  hf->map_size = (size_t)(HRAB_HEADER_SIZE + count * HRAB_RECORD_SIZE);
+#if !defined(_WIN32)
+  void *map = mmap(NULL, hf->map_size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+  fclose(fp);
+  if (map == MAP_FAILED) {
+    free(hf);
+    return NULL;
+  }
+  hf->map = map;
+#else
+  // No mmap: read the whole file into memory instead
+  hf->map = malloc(hf->map_size);
+  bool ok = hf->map && fseek(fp, 0, SEEK_SET) == 0 &&
+            fread(hf->map, 1, hf->map_size, fp) == hf->map_size;
+  fclose(fp);
+  if (!ok) {
+    free(hf->map);
+    free(hf);
+    return NULL;
+  }
+#endif
+  hf->records = (const HrabRecord *)((const uint8_t *)hf->map +
+                                     HRAB_HEADER_SIZE);
+  // Callers index fixed-size node arrays with n_nodes, so a malformed
+  // record rejects the whole file
+  uint8_t allowed[HRAB_MAX_NODES + 1][HRAB_MASK_BYTES];
+  build_node_masks(allowed);
+  for (long long i = 0; i < count; i++)
+    if (!record_valid(&hf->records[i], allowed)) {
+      hrab_close(hf);
+      return NULL;
+    }
+  return hf;
+}
+
+void hrab_close(HrabFile *hf) {
+  if (!hf)
+    return;
+#if !defined(_WIN32)
+  munmap(hf->map, hf->map_size);
+#else
+  free(hf->map);
+#endif
+  free(hf);
+}
+
+long long hrab_count(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return -1;
+  uint8_t hdr[HRAB_HEADER_SIZE];
+  long long count = -1;
+  if (fread(hdr, 1, sizeof(hdr), fp) == sizeof(hdr))
+    count = parse_header(hdr);
+  struct stat st;
+  if (count >= 0 && (fstat(fileno(fp), &st) != 0 ||
+                     !count_fits(count, (long long)st.st_size)))
+    count = -1;
+  fclose(fp);
+  return count;
+}
+
+// Streaming writer
+HrabWriter *hrab_open_writer(const char *path) {
+  HrabWriter *w = malloc(sizeof(HrabWriter));
+  if (!w)
+    return NULL;
+  w->fp = fopen(path, "wb");
+  w->count = 0;
+  uint8_t hdr[HRAB_HEADER_SIZE];
+  build_header(hdr, 0);
+  if (!w->fp || fwrite(hdr, 1, sizeof(hdr), w->fp) != sizeof(hdr)) {
+    if (w->fp)
+      fclose(w->fp);
+    free(w);
+    return NULL;
+  }
+  return w;
+}
+
+bool hrab_write(HrabWriter *w, const HrabRecord *rec) {
+  if (fwrite(rec, HRAB_RECORD_SIZE, 1, w->fp) != 1)
+    return false;
+  w->count++;
+  return true;
+}
+
+bool hrab_close_writer(HrabWriter *w) {
+  if (!w)
+    return false;
+  uint8_t hdr[HRAB_HEADER_SIZE];
+  build_header(hdr, w->count);
+  bool ok = fseek(w->fp, 0, SEEK_SET) == 0 &&
+            fwrite(hdr, 1, sizeof(hdr), w->fp) == sizeof(hdr);
+  ok = (fclose(w->fp) == 0) && ok;
+  free(w);
+  return ok;
+}
+
+bool hrab_has_extension(const char *path) {
+  size_t len = strlen(path);
+  return len >= 5 && strcmp(path + len - 5, ".hrab") == 0;
+}
@@ -0,0 +1,66 @@
+#ifndef HRA_BINARY_H
+#define HRA_BINARY_H
+
+// Compact binary graph format (.hrab).
+//
+// A 32-byte header followed by fixed 32-byte records, one per graph. Each
+// record packs the node count, edge count, a bit per possible edge
+// (bit from * HRAB_MAX_NODES + to) and a bit per black (label 1) edge, plus
+// an optional source id for expansion results. Everything is stored byte by
+// byte or little-endian, so files are portable. The format does not depend
+// on either Graph struct so hra_test3 and the sampler tools can share it.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define HRAB_MAX_NODES 10
+#define HRAB_MASK_BYTES ((HRAB_MAX_NODES * HRAB_MAX_NODES + 7) / 8)
+#define HRAB_HEADER_SIZE 32
+#define HRAB_RECORD_SIZE 32
+#define HRAB_NO_SOURCE (-1)
+
+typedef struct {
+  uint8_t n_nodes;
+  uint8_t n_edges;
+  uint8_t edges[HRAB_MASK_BYTES];  // bit set if from -> to exists
+  uint8_t labels[HRAB_MASK_BYTES]; // bit set if that edge is black
+  uint8_t source[4];               // int32 little-endian, HRAB_NO_SOURCE
+} HrabRecord;
+
+// Read-only view of a whole file, mmap'ed where available
+typedef struct {
+  const HrabRecord *records;
+  long long count;
+  void *map;
+  size_t map_size;
+} HrabFile;
+
+typedef struct {
+  FILE *fp;
+  long long count;
+} HrabWriter;
+
+// Record encoding. adj is row-major with the given stride; -1 means no edge,
+// 0 gray and 1 black. Edges come back in row-major order.
+void hrab_encode(HrabRecord *rec, int n_nodes, const int *adj, int stride,
+                 int source_id);
+int hrab_node_count(const HrabRecord *rec);
+int hrab_source(const HrabRecord *rec);
+int hrab_edge(const HrabRecord *rec, int from, int to); // -1, 0 or 1
+int hrab_decode_edges(const HrabRecord *rec, int *from, int *to, int *label);
+
+// mmap-based reader. Files whose count does not fit their size, or with a
+// record of more than HRAB_MAX_NODES nodes or stray edge bits, are rejected.
+HrabFile *hrab_open(const char *path);
+void hrab_close(HrabFile *hf);
+long long hrab_count(const char *path); // header and size only, -1 on error
+
+// Streaming writer; the header count is patched in on close
+HrabWriter *hrab_open_writer(const char *path);
+bool hrab_write(HrabWriter *w, const HrabRecord *rec);
+bool hrab_close_writer(HrabWriter *w);
+
+bool hrab_has_extension(const char *path);
+
+#endif // HRA_BINARY_H
@@ -0,0 +1,338 @@
+// Persistent canonical-form cache shared across runs.
+//
+// Maps a graph exactly as given (its packed adjacency, encoded as an .hrab
+// key) to its canonical key and a canonical id: the number of its class in
+// the cache, stable for as long as the cache file lives. The file is
+//
+//   header | entries[n_entries] | classes[n_classes] |
+//   entry_slots[entry_slot_capacity] | class_slots[class_slot_capacity]
+//
+// where each entry is the raw key with the class id in its source field,
+// each class is the canonical key with its own id there, and the slot
+// tables are open-addressing hashes over the two arrays. The header records
+// the canonicalizer version; a file from another version, or one whose ids
+// and slots do not all point into its arrays, is ignored.
+//
+// The file is mapped read-only and never modified in place: canon_cache_save
+// writes a merged copy and renames it over the old one, so any number of
+// processes can map and read it at once, and a reader keeps the version it
+// opened. If two runs save at the same time the last rename wins, and the
+// other run's new entries are simply recomputed next time.
+//
+// Graphs missed by the mapped file are canonicalized as usual and kept in
+// an in-memory overlay, under one lock, until the run saves.
+#include "hra_sampler.h"
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+#define CANON_CACHE_MAGIC "HRACCF2"
+#define CANON_CACHE_MAX_ENTRIES (1 << 24) // stop adding beyond this
+
+typedef struct {
+  char magic[8];
+  int canon_version; // PACKED_CANON_VERSION
+  int n_entries;
+  int n_classes;
+  int entry_slot_capacity;
+  int class_slot_capacity;
+} CanonCacheHeader;
+
+static struct {
+  bool enabled;
+  char path[MAX_FILENAME];
+  void *map;
+  size_t map_size;
+  KeyTable mapped_entries, mapped_classes; // views into map, not freed
+  KeyTable new_entries, new_classes;       // overlay
+  pthread_mutex_t lock;
+  long long hits;
+  long long misses;
+} g_cache = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+// The graph as given, in .hrab key form
+static void packed_raw_key(const PackedGraph *pg, HrabRecord *key) {
+  memset(key, 0, sizeof(*key));
+  key->n_nodes = pg->n_nodes;
+  int n_edges = 0;
+  for (int i = 0; i < pg->n_nodes; i++)
+    for (unsigned int m = pg->out[i]; m; m &= m - 1) {
+      int j = packed_lowest_node(m);
+      int bit = i * HRAB_MAX_NODES + j;
+      key->edges[bit / 8] |= (uint8_t)(1u << (bit % 8));
+      if ((pg->black[i] >> j) & 1)
+        key->labels[bit / 8] |= (uint8_t)(1u << (bit % 8));
+      n_edges++;
+    }
+  key->n_edges = (uint8_t)n_edges;
+}
+
+// Class id in the record's source field, little-endian like hrab_encode
+static void set_key_id(HrabRecord *key, int id) {
+  for (int i = 0; i < 4; i++)
+    key->source[i] = (uint8_t)((unsigned int)id >> (8 * i));
+}
+
+static void class_to_rep(const HrabRecord *cls, int *canon) {
+  int n = hrab_node_count(cls);
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+      canon[i * n + j] = hrab_edge(cls, i, j);
+}
+
+// Each class carries its own index as id, and each entry the id of a class
+// with as many nodes
+static bool cache_ids_valid(const KeyTable *entries, const KeyTable *classes) {
+  for (int c = 0; c < classes->count; c++)
+    if (hrab_source(&classes->keys[c]) != c ||
+        hrab_node_count(&classes->keys[c]) > MAX_NODES)
+      return false;
+  for (int e = 0; e < entries->count; e++) {
+    int id = hrab_source(&entries->keys[e]);
+    if (id < 0 || id >= classes->count ||
+        hrab_node_count(&classes->keys[id]) !=
+            hrab_node_count(&entries->keys[e]))
+      return false;
+  }
+  return true;
+}
+
+// Map path if it holds a well-formed cache; an absent or bad file just
+// starts an empty one
+static void map_cache_file(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return;
+  CanonCacheHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  struct stat st;
+  bool ok = fread(&hdr, sizeof(hdr), 1, fp) == 1 &&
+            memcmp(hdr.magic, CANON_CACHE_MAGIC, sizeof(hdr.magic)) == 0;
+  if (ok && hdr.canon_version != PACKED_CANON_VERSION) {
+    fclose(fp);
+    fprintf(stderr,
+            "Warning: Ignoring canonical cache %s from canonical form "
+            "version %d\n",
+            path, hdr.canon_version);
+    return;
+  }
+  ok = ok && fstat(fileno(fp), &st) == 0 && hdr.n_entries >= 0 &&
+       hdr.n_entries <= CANON_CACHE_MAX_ENTRIES && hdr.n_classes >= 0 &&
+       hdr.n_classes <= CANON_CACHE_MAX_ENTRIES &&
+       hdr.entry_slot_capacity == key_table_slot_capacity(hdr.n_entries) &&
+       hdr.class_slot_capacity == key_table_slot_capacity(hdr.n_classes);
+  size_t size = sizeof(hdr) +
+                ((size_t)hdr.n_entries + hdr.n_classes) * sizeof(HrabRecord) +
+                ((size_t)hdr.entry_slot_capacity + hdr.class_slot_capacity) *
+                    sizeof(int);
+  if (!ok || (size_t)st.st_size != size) {
+    fclose(fp);
+    fprintf(stderr, "Warning: Ignoring malformed canonical cache %s\n", path);
+    return;
+  }
+#if !defined(_WIN32)
+  void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+  fclose(fp);
+  if (map == MAP_FAILED)
+    return;
+#else
+  // No mmap: read the whole file into memory instead
+  void *map = malloc(size);
+  ok = map && fseek(fp, 0, SEEK_SET) == 0 && fread(map, 1, size, fp) == size;
+  fclose(fp);
+  if (!ok) {
+    free(map);
+    return;
+  }
+#endif
+  KeyTable entries = {0}, classes = {0};
+  char *p = (char *)map + sizeof(hdr);
+  entries.keys = (HrabRecord *)p;
+  entries.count = hdr.n_entries;
+  p += (size_t)hdr.n_entries * sizeof(HrabRecord);
+  classes.keys = (HrabRecord *)p;
+  classes.count = hdr.n_classes;
+  p += (size_t)hdr.n_classes * sizeof(HrabRecord);
+  entries.slots = (int *)p;
+  entries.slot_capacity = hdr.entry_slot_capacity;
+  p += (size_t)hdr.entry_slot_capacity * sizeof(int);
+  classes.slots = (int *)p;
+  classes.slot_capacity = hdr.class_slot_capacity;
+  if (!cache_ids_valid(&entries, &classes) || !key_table_valid(&entries) ||
+      !key_table_valid(&classes)) {
+#if !defined(_WIN32)
+    munmap(map, size);
+#else
+    free(map);
+#endif
+    fprintf(stderr, "Warning: Ignoring malformed canonical cache %s\n", path);
+    return;
+  }
+  g_cache.map = map;
+  g_cache.map_size = size;
+  g_cache.mapped_entries = entries;
+  g_cache.mapped_classes = classes;
+}
+
+bool canon_cache_open(const char *path) {
+  canon_cache_close();
+  snprintf(g_cache.path, sizeof(g_cache.path), "%s", path);
+  map_cache_file(path);
+  g_cache.enabled = true;
+  return g_cache.map != NULL;
+}
+
+void canon_cache_close(void) {
+  if (g_cache.map) {
+#if !defined(_WIN32)
+    munmap(g_cache.map, g_cache.map_size);
+#else
+    free(g_cache.map);
+#endif
+  }
+  g_cache.map = NULL;
+  memset(&g_cache.mapped_entries, 0, sizeof(KeyTable));
+  memset(&g_cache.mapped_classes, 0, sizeof(KeyTable));
+  key_table_free(&g_cache.new_entries);
+  key_table_free(&g_cache.new_classes);
+  g_cache.enabled = false;
+  g_cache.hits = g_cache.misses = 0;
+}
+
+int canonical_rep_cached(const PackedGraph *pg, int *canon) {
+  if (!g_cache.enabled) {
+    packed_canonical_rep(pg, canon);
+    return -1;
+  }
+  HrabRecord raw;
+  packed_raw_key(pg, &raw);
+
+  // The mapped file needs no lock
+  int e = key_table_find(&g_cache.mapped_entries, &raw);
+  if (e >= 0) {
+    int id = hrab_source(&g_cache.mapped_entries.keys[e]);
+    class_to_rep(&g_cache.mapped_classes.keys[id], canon);
+    __atomic_add_fetch(&g_cache.hits, 1, __ATOMIC_RELAXED);
+    return id;
+  }
+
+  int n_mapped = g_cache.mapped_classes.count;
+  pthread_mutex_lock(&g_cache.lock);
+  e = key_table_find(&g_cache.new_entries, &raw);
+  if (e >= 0) {
+    int id = hrab_source(&g_cache.new_entries.keys[e]);
+    class_to_rep(&g_cache.new_classes.keys[id - n_mapped], canon);
+    __atomic_add_fetch(&g_cache.hits, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&g_cache.lock);
+    return id;
+  }
+  __atomic_add_fetch(&g_cache.misses, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&g_cache.lock);
+
+  // Canonicalize outside the lock
+  packed_canonical_rep(pg, canon);
+  int n = pg->n_nodes;
+  HrabRecord cls;
+  hrab_encode(&cls, n, canon, n, 0);
+
+  pthread_mutex_lock(&g_cache.lock);
+  int id = key_table_find(&g_cache.mapped_classes, &cls);
+  if (id < 0) {
+    int c = key_table_find(&g_cache.new_classes, &cls);
+    id = c >= 0 ? n_mapped + c : -1;
+  }
+  // Another thread may have added the same graph meanwhile. Past the size
+  // limit graphs are still canonicalized, just not remembered.
+  int total = g_cache.mapped_entries.count + g_cache.new_entries.count;
+  if (total < CANON_CACHE_MAX_ENTRIES &&
+      key_table_find(&g_cache.new_entries, &raw) < 0) {
+    bool ok = true;
+    if (id < 0) {
+      id = n_mapped + g_cache.new_classes.count;
+      set_key_id(&cls, id);
+      ok = key_table_add(&g_cache.new_classes, &cls);
+      if (!ok)
+        id = -1;
+    }
+    set_key_id(&raw, id);
+    if (ok)
+      key_table_add(&g_cache.new_entries, &raw);
+  }
+  pthread_mutex_unlock(&g_cache.lock);
+  return id;
+}
+
+// Write the mapped and new entries to a temporary file, then rename it
+// over the cache. Classes keep their ids: new ones follow the mapped ones.
+bool canon_cache_save(void) {
+  if (!g_cache.enabled)
+    return false;
+  if (g_cache.new_entries.count == 0)
+    return true;
+  KeyTable entries = {0}, classes = {0};
+  const KeyTable *parts[2][2] = {
+      {&g_cache.mapped_entries, &g_cache.new_entries},
+      {&g_cache.mapped_classes, &g_cache.new_classes}};
+  KeyTable *merged[2] = {&entries, &classes};
+  bool ok = true;
+  for (int t = 0; t < 2 && ok; t++) {
+    int count = parts[t][0]->count + parts[t][1]->count;
+    merged[t]->keys = malloc((count > 0 ? count : 1) * sizeof(HrabRecord));
+    ok = merged[t]->keys != NULL;
+    if (!ok)
+      break;
+    for (int p = 0; p < 2; p++) {
+      memcpy(merged[t]->keys + merged[t]->count, parts[t][p]->keys,
+             parts[t][p]->count * sizeof(HrabRecord));
+      merged[t]->count += parts[t][p]->count;
+    }
+    ok = key_table_rehash(merged[t], key_table_slot_capacity(count));
+  }
+
+  char tmp_path[MAX_FILENAME + 32];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%d", g_cache.path,
+           (int)getpid());
+  FILE *fp = ok ? fopen(tmp_path, "wb") : NULL;
+  if (fp) {
+    CanonCacheHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CANON_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.canon_version = PACKED_CANON_VERSION;
+    hdr.n_entries = entries.count;
+    hdr.n_classes = classes.count;
+    hdr.entry_slot_capacity = entries.slot_capacity;
+    hdr.class_slot_capacity = classes.slot_capacity;
+    ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+         fwrite(entries.keys, sizeof(HrabRecord), entries.count, fp) ==
+             (size_t)entries.count &&
+         fwrite(classes.keys, sizeof(HrabRecord), classes.count, fp) ==
+             (size_t)classes.count &&
+         fwrite(entries.slots, sizeof(int), entries.slot_capacity, fp) ==
+             (size_t)entries.slot_capacity &&
+         fwrite(classes.slots, sizeof(int), classes.slot_capacity, fp) ==
+             (size_t)classes.slot_capacity;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp_path, g_cache.path) != 0) {
+      remove(tmp_path);
+      ok = false;
+    }
+  } else {
+    ok = false;
+  }
+  key_table_free(&entries);
+  key_table_free(&classes);
+  return ok;
+}
+
+void print_canon_cache_stats(void) {
+  if (!g_cache.enabled)
+    return;
+  printf("Canonical cache %s: %d graphs in %d classes", g_cache.path,
+         g_cache.mapped_entries.count + g_cache.new_entries.count,
+         g_cache.mapped_classes.count + g_cache.new_classes.count);
+  long long lookups = g_cache.hits + g_cache.misses;
+  if (lookups > 0)
+    printf(", %lld hits / %lld lookups (%.1f%%)", g_cache.hits, lookups,
+           100.0 * g_cache.hits / lookups);
+  printf("\n");
+}
@@ -0,0 +1,319 @@
+// Multi-generation evolution chain for hra_runner (--chain).
+//
+// The frontier of one level is kept in memory as canonical keys (one
+// HrabRecord per class, source field unused), expanded in-process by the
+// runner's work-stealing workers, and deduplicated into the next frontier.
+// Nothing is written per child; each level prints a summary and, with
+// --checkpoint, its frontier as chain/chain_n<k>.hrab under the results
+// directory (kept out of the files analyze_results reads).
+#include "hra_sampler.h"
+
+typedef struct {
+  HrabRecord key;   // canonical form, source field zero
+  int first_source; // lowest frontier index that produced it
+  int source_count; // distinct frontier graphs that produced it
+} ChainEntry;
+
+// Open-addressing set of canonical keys, shared by the workers under lock.
+// Keys are hashed and compared like the reference index's, on
+// CANON_KEY_BYTES.
+typedef struct {
+  ChainEntry *entries;
+  int count;
+  int capacity;
+  int *slots; // -1 marks an empty slot
+  int slot_capacity;
+  long long children; // expansions emitted, before any deduplication
+} ChainTable;
+
+typedef struct {
+  HrabRecord *keys;
+  int count;
+  int capacity;
+  bool failed;
+} ChildKeys;
+
+typedef struct {
+  int thread_id;
+  const HrabRecord *frontier;
+  int target_size;
+  WorkQueue *queue;
+  ChainTable *table;
+  pthread_mutex_t *table_lock;
+  bool failed;
+} ChainWorker;
+
+static bool chain_rehash(ChainTable *t, int slot_capacity) {
+  int *slots = malloc(slot_capacity * sizeof(int));
+  if (!slots)
+    return false;
+  for (int i = 0; i < slot_capacity; i++)
+    slots[i] = -1;
+  unsigned long long mask = (unsigned long long)slot_capacity - 1;
+  for (int i = 0; i < t->count; i++) {
+    unsigned long long s = canon_key_hash(&t->entries[i].key) & mask;
+    while (slots[s] != -1)
+      s = (s + 1) & mask;
+    slots[s] = i;
+  }
+  free(t->slots);
+  t->slots = slots;
+  t->slot_capacity = slot_capacity;
+  return true;
+}
+
+static bool chain_table_init(ChainTable *t) {
+  memset(t, 0, sizeof(*t));
+  t->capacity = 1024;
+  t->entries = malloc(t->capacity * sizeof(ChainEntry));
+  return t->entries && chain_rehash(t, 2048);
+}
+
+static void chain_table_free(ChainTable *t) {
+  free(t->entries);
+  free(t->slots);
+}
+
+// Record that source produced key; each source is inserted at most once
+// per key
+static bool chain_table_add(ChainTable *t, const HrabRecord *key,
+                            int source) {
+  unsigned long long mask = (unsigned long long)t->slot_capacity - 1;
+  unsigned long long s = canon_key_hash(key) & mask;
+  while (t->slots[s] != -1) {
+    ChainEntry *e = &t->entries[t->slots[s]];
+    if (memcmp(&e->key, key, CANON_KEY_BYTES) == 0) {
+      e->source_count++;
+      if (source < e->first_source)
+        e->first_source = source;
+      return true;
+    }
+    s = (s + 1) & mask;
+  }
+  if (t->count >= t->capacity) {
+    int nc = t->capacity * 2;
+    ChainEntry *tmp = realloc(t->entries, nc * sizeof(ChainEntry));
+    if (!tmp)
+      return false;
+    t->entries = tmp;
+    t->capacity = nc;
+  }
+  // Keep the load factor at or below one half
+  if (2 * (t->count + 1) > t->slot_capacity) {
+    if (!chain_rehash(t, t->slot_capacity * 2))
+      return false;
+    mask = (unsigned long long)t->slot_capacity - 1;
+    s = canon_key_hash(key) & mask;
+    while (t->slots[s] != -1)
+      s = (s + 1) & mask;
+  }
+  ChainEntry *e = &t->entries[t->count];
+  e->key = *key;
+  e->first_source = source;
+  e->source_count = 1;
+  t->slots[s] = t->count++;
+  return true;
+}
+
+static int compare_keys(const void *a, const void *b) {
+  return memcmp(a, b, sizeof(HrabRecord));
+}
+
+static int compare_entries(const void *a, const void *b) {
+  return memcmp(&((const ChainEntry *)a)->key, &((const ChainEntry *)b)->key,
+                sizeof(HrabRecord));
+}
+
+// Sink collecting the canonical keys of one source's children
+static void chain_sink_emit(ExpandSink *sink, const Graph *child,
+                            const char *canonical_rep, int source_id,
+                            int child_index) {
+  (void)source_id;
+  (void)child_index;
+  ChildKeys *ck = sink->ctx;
+  if (ck->count >= ck->capacity) {
+    int nc = ck->capacity ? 2 * ck->capacity : 256;
+    HrabRecord *tmp = realloc(ck->keys, nc * sizeof(HrabRecord));
+    if (!tmp) {
+      ck->failed = true;
+      return;
+    }
+    ck->keys = tmp;
+    ck->capacity = nc;
+  }
+  int n = child->n_nodes;
+  hrab_encode(&ck->keys[ck->count++], n, (const int *)canonical_rep, n, 0);
+}
+
+static void *chain_worker(void *arg) {
+  ChainWorker *w = arg;
+  ChildKeys ck = {NULL, 0, 0, false};
+  ExpandSink sink = {chain_sink_emit, &ck};
+  int begin, end;
+  bool stolen;
+  while (!w->failed &&
+         next_work_chunk(w->queue, w->thread_id, &begin, &end, &stolen)) {
+    for (int src = begin; src < end && !w->failed; src++) {
+      Graph base;
+      hrab_to_graph(&w->frontier[src], &base);
+      ck.count = 0;
+      int emitted = 0;
+      expand_single_graph(&base, w->target_size, &sink, &emitted, src);
+      if (ck.failed) {
+        w->failed = true;
+        break;
+      }
+      // A source counts once per class, however many patterns reach it
+      qsort(ck.keys, ck.count, sizeof(HrabRecord), compare_keys);
+      pthread_mutex_lock(w->table_lock);
+      w->table->children += emitted;
+      for (int i = 0; i < ck.count && !w->failed; i++)
+        if (i == 0 || compare_keys(&ck.keys[i - 1], &ck.keys[i]) != 0)
+          w->failed = !chain_table_add(w->table, &ck.keys[i], src);
+      pthread_mutex_unlock(w->table_lock);
+    }
+  }
+  free(ck.keys);
+  return NULL;
+}
+
+// Expand every frontier graph by one node into table
+static bool expand_level(const HrabRecord *frontier, int n_frontier,
+                         int target_size, int num_threads, ChainTable *table) {
+  pthread_t threads[MAX_THREADS];
+  ChainWorker workers[MAX_THREADS];
+  pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+  WorkQueue queue;
+  init_work_queue(&queue, num_threads, n_frontier);
+  int started = 0;
+  for (int i = 0; i < num_threads; i++) {
+    workers[i].thread_id = i;
+    workers[i].frontier = frontier;
+    workers[i].target_size = target_size;
+    workers[i].queue = &queue;
+    workers[i].table = table;
+    workers[i].table_lock = &table_lock;
+    workers[i].failed = false;
+    if (pthread_create(&threads[i], NULL, chain_worker, &workers[i]) != 0) {
+      perror("Failed to create thread");
+      // Let the started workers drain the queue
+      break;
+    }
+    started++;
+  }
+  bool ok = started > 0;
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+    ok = ok && !workers[i].failed;
+  }
+  destroy_work_queue(&queue);
+  pthread_mutex_destroy(&table_lock);
+  return ok;
+}
+
+static bool write_checkpoint(const char *output_dir, int n,
+                             const ChainTable *t) {
+  char path[MAX_FILENAME];
+  snprintf(path, sizeof(path), "%s/chain", output_dir);
+  if (mkdir(path, 0755) != 0 && errno != EEXIST)
+    return false;
+  snprintf(path, sizeof(path), "%s/chain/chain_n%d.hrab", output_dir, n);
+  HrabWriter *w = hrab_open_writer(path);
+  if (!w)
+    return false;
+  bool ok = true;
+  for (int i = 0; ok && i < t->count; i++) {
+    HrabRecord rec = t->entries[i].key;
+    Graph g;
+    hrab_to_graph(&rec, &g);
+    graph_to_hrab(&g, t->entries[i].first_source, &rec);
+    ok = hrab_write(w, &rec);
+  }
+  ok = hrab_close_writer(w) && ok;
+  if (ok)
+    printf("Checkpoint: %s\n", path);
+  return ok;
+}
+
+int run_evolution_chain(const HrabRecord *sources, int n_sources,
+                        int start_size, int target_size, int num_threads,
+                        const char *output_dir, bool checkpoint) {
+  HrabRecord *frontier = malloc((n_sources > 0 ? n_sources : 1) *
+                                sizeof(HrabRecord));
+  if (!frontier)
+    return -1;
+  memcpy(frontier, sources, n_sources * sizeof(HrabRecord));
+  int n_frontier = n_sources;
+  int status = 0;
+
+  for (int n = start_size; n < target_size && status == 0; n++) {
+    ChainTable table;
+    if (!chain_table_init(&table)) {
+      status = -1;
+      break;
+    }
+    double start = wall_time_seconds();
+    if (!expand_level(frontier, n_frontier, n + 1, num_threads, &table)) {
+      fprintf(stderr, "Error: Expansion to n=%d failed (out of memory?)\n",
+              n + 1);
+      status = -1;
+    }
+    double elapsed = wall_time_seconds() - start;
+
+    // Canonical order, so the next level does not depend on thread timing
+    qsort(table.entries, table.count, sizeof(ChainEntry), compare_entries);
+    int multi = 0, singles = 0;
+    for (int i = 0; i < table.count; i++) {
+      if (table.entries[i].source_count > 1)
+        multi++;
+      else
+        singles++;
+    }
+    printf("\n=== Level n=%d -> n=%d ===\n", n, n + 1);
+    printf("Sources: %d\n", n_frontier);
+    printf("Children generated: %lld\n", table.children);
+    printf("Unique graphs: %d\n", table.count);
+    char ref_path[MAX_FILENAME];
+    int total_target = reference_hra_file(n + 1, ref_path, sizeof(ref_path));
+    if (total_target > 0) {
+      printf("Ratio (unique/total reference hras_n%d): %.4f (%d/%d)\n", n + 1,
+             (double)table.count / total_target, table.count, total_target);
+      CanonIndex *ci = load_canon_index(ref_path);
+      if (ci) {
+        int covered = 0;
+        for (int i = 0; i < table.count; i++)
+          covered += canon_index_find(ci, &table.entries[i].key) >= 0;
+        print_reference_coverage(ci, n + 1, covered, table.count);
+        free_canon_index(ci);
+      }
+    }
+    printf("Graphs appearing from >1 sources: %d\n", multi);
+    printf("Singleton graphs (exactly 1 source): %d\n", singles);
+    printf("Time: %.2f seconds\n", elapsed);
+    if (status == 0 && checkpoint && !write_checkpoint(output_dir, n + 1,
+                                                       &table)) {
+      fprintf(stderr, "Error: Failed to write checkpoint for n=%d\n", n + 1);
+      status = -1;
+    }
+
+    // The deduplicated classes are the next frontier
+    HrabRecord *next = malloc((table.count > 0 ? table.count : 1) *
+                              sizeof(HrabRecord));
+    if (!next)
+      status = -1;
+    else {
+      for (int i = 0; i < table.count; i++)
+        next[i] = table.entries[i].key;
+      free(frontier);
+      frontier = next;
+      n_frontier = table.count;
+    }
+    chain_table_free(&table);
+    if (n_frontier == 0 && n + 1 < target_size) {
+      printf("Frontier is empty; stopping at n=%d\n", n + 1);
+      break;
+    }
+  }
+  free(frontier);
+  return status;
+}
@@ -0,0 +1,95 @@
+// Convert graph files between DOT text and the binary .hrab format
+#include "hra_sampler.h"
+
+static int dot_to_hrab(const char *input_file, const char *output_file) {
+  FILE *fp = fopen(input_file, "r");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open input file %s\n", input_file);
+    return -1;
+  }
+  HrabWriter *w = hrab_open_writer(output_file);
+  if (!w) {
+    fprintf(stderr, "Error: Cannot open output file %s\n", output_file);
+    fclose(fp);
+    return -1;
+  }
+
+  Graph g;
+  int graph_id = 0, source_id = -1;
+  bool ok = true;
+  while (ok && parse_single_dot_graph(fp, &g, &graph_id, &source_id)) {
+    // Keep provenance from "// Source:<id>" comments in result files
+    HrabRecord rec;
+    graph_to_hrab(&g, source_id, &rec);
+    ok = hrab_write(w, &rec);
+  }
+  fclose(fp);
+  int count = (int)w->count;
+  if (!hrab_close_writer(w) || !ok) {
+    fprintf(stderr, "Error: Failed to write %s\n", output_file);
+    return -1;
+  }
+  return count;
+}
+
+// Same layout hra_test3 writes, so reference sets round-trip unchanged
+static int hrab_to_dot(const char *input_file, const char *output_file) {
+  HrabFile *hf = hrab_open(input_file);
+  if (!hf) {
+    fprintf(stderr, "Error: Cannot read %s as .hrab\n", input_file);
+    return -1;
+  }
+  FILE *fp = fopen(output_file, "w");
+  if (!fp) {
+    fprintf(stderr, "Error: Cannot open output file %s\n", output_file);
+    hrab_close(hf);
+    return -1;
+  }
+
+  for (long long i = 0; i < hf->count; i++) {
+    const HrabRecord *rec = &hf->records[i];
+    int from[MAX_EDGES], to[MAX_EDGES], label[MAX_EDGES];
+    int n_edges = hrab_decode_edges(rec, from, to, label);
+    if (i > 0)
+      fprintf(fp, "\n");
+    if (hrab_source(rec) != HRAB_NO_SOURCE)
+      fprintf(fp, "// Source:%d\n", hrab_source(rec));
+    fprintf(fp, "digraph HRA_n%d_%03lld {\n", hrab_node_count(rec), i + 1);
+    for (int e = 0; e < n_edges; e++)
+      fprintf(fp, "  %d -> %d [label=\"%d\"];\n", from[e], to[e], label[e]);
+    fprintf(fp, "}\n");
+  }
+  int count = (int)hf->count;
+  hrab_close(hf);
+  if (fclose(fp) != 0) {
+    fprintf(stderr, "Error: Failed to write %s\n", output_file);
+    return -1;
+  }
+  return count;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    fprintf(stderr,
+            "Usage: %s <input.dot|input.hrab> <output.hrab|output.dot>\n",
+            argv[0]);
+    return 1;
+  }
+
+  const char *input_file = argv[1];
+  const char *output_file = argv[2];
+  bool to_binary = hrab_has_extension(output_file);
+  if (to_binary == hrab_has_extension(input_file)) {
+    fprintf(stderr, "Error: Convert DOT to .hrab or .hrab to DOT\n");
+    return 1;
+  }
+
+  double start = wall_time_seconds();
+  int count = to_binary ? dot_to_hrab(input_file, output_file)
+                        : hrab_to_dot(input_file, output_file);
+  if (count < 0)
+    return 1;
+  printf("Converted %d graphs from %s to %s in %.2f seconds\n", count,
+         input_file, output_file, wall_time_seconds() - start);
+  return 0;
+}
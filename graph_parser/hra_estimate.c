@@ -0,0 +1,195 @@
+// Estimate topology, RA and HRA counts, and the one-node expansion
+// coverage, from random samples for sizes too large to enumerate.
+//
+// Graphs are drawn uniformly over labelled graphs on n nodes. A class with
+// automorphism group A has n!/|A| labelled members, so weighting each draw
+// by |A| makes every class equally likely: the class count is
+// states^(n(n-1)) / n! times the mean weight of the valid draws (invalid
+// draws weigh 0). Intervals are normal 95% intervals from the sample
+// variance.
+#include "hra_sampler.h"
+#include <math.h>
+
+#define DEFAULT_SAMPLES 100000
+#define Z_95 1.959964
+
+// Running sums for a mean and its standard error
+typedef struct {
+  double sum;
+  double sum_sq;
+} MeanStats;
+
+static void add_mean(MeanStats *s, double y) {
+  s->sum += y;
+  s->sum_sq += y * y;
+}
+
+// Half-width of the interval for the mean of samples draws
+static double mean_half_width(const MeanStats *s, long long samples) {
+  if (samples < 2)
+    return 0.0;
+  double mean = s->sum / samples;
+  double var = (s->sum_sq - samples * mean * mean) / (samples - 1);
+  return var > 0 ? Z_95 * sqrt(var / samples) : 0.0;
+}
+
+// Weighted proportion sum(w r) / sum(w) for r in {0, 1}, with a
+// delta-method interval
+typedef struct {
+  double w;
+  double w_hit;
+  double w_sq;
+  double w_sq_hit;
+} RatioStats;
+
+static void add_ratio(RatioStats *s, double w, bool hit) {
+  s->w += w;
+  s->w_sq += w * w;
+  if (hit) {
+    s->w_hit += w;
+    s->w_sq_hit += w * w;
+  }
+}
+
+static double ratio_value(const RatioStats *s) {
+  return s->w > 0 ? s->w_hit / s->w : 0.0;
+}
+
+static double ratio_half_width(const RatioStats *s) {
+  if (s->w <= 0)
+    return 0.0;
+  double r = ratio_value(s);
+  // sum of (w_i (hit_i - r))^2
+  double dev = s->w_sq_hit - 2 * r * s->w_sq_hit + r * r * s->w_sq;
+  return dev > 0 ? Z_95 * sqrt(dev) / s->w : 0.0;
+}
+
+// True if removing some node leaves an HRA on n - 1 nodes, i.e. the graph
+// can come out of the runner's one-node expansion of the n - 1 reference set
+static bool has_hra_deletion(const PackedGraph *g) {
+  int n = g->n_nodes;
+  for (int v = 0; v < n; v++) {
+    PackedGraph sub;
+    packed_init(&sub, n - 1);
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < n; j++) {
+        int r = packed_edge(g, i, j);
+        if (i != v && j != v && r >= 0)
+          packed_add_edge(&sub, i - (i > v), j - (j > v), r);
+      }
+    if (packed_is_weakly_connected(&sub) &&
+        packed_is_heritable_regulatory(&sub))
+      return true;
+  }
+  return false;
+}
+
+static void print_count(const char *name, double scale, const MeanStats *s,
+                        long long samples) {
+  double mean = s->sum / samples;
+  printf("  %-42s %.6g +/- %.2g\n", name, scale * mean,
+         scale * mean_half_width(s, samples));
+}
+
+// Coverage measured directly on a reference file, whose graphs are one per
+// class, so plain uniform draws suffice
+static void estimate_reference_coverage(const char *path, long long samples) {
+  int total = hrab_has_extension(path) ? (int)hrab_count(path)
+                                       : dot_index_count(path);
+  if (total <= 0)
+    return;
+  RatioStats coverage = {0};
+  long long drawn = 0;
+  double start = wall_time_seconds();
+  for (; drawn < samples; drawn++) {
+    SampledGraph *sg = randomly_sample_graph(path, total);
+    if (!sg)
+      break;
+    PackedGraph pg;
+    graph_to_packed(&sg->graph, &pg);
+    add_ratio(&coverage, 1.0, has_hra_deletion(&pg));
+    free(sg);
+  }
+  double elapsed = wall_time_seconds() - start;
+  printf("\nReference %s (%d HRAs), %lld draws:\n", path, total, drawn);
+  printf("  %-42s %.4f +/- %.2g\n", "Expansion coverage:",
+         ratio_value(&coverage), ratio_half_width(&coverage));
+  printf("  %-42s %.0f\n", "Draws per second:",
+         elapsed > 0 ? drawn / elapsed : 0.0);
+}
+
+int main(int argc, char *argv[]) {
+  int n = argc > 1 ? atoi(argv[1]) : 0;
+  long long samples = argc > 2 ? atoll(argv[2]) : DEFAULT_SAMPLES;
+  unsigned long long seed =
+      argc > 3 ? strtoull(argv[3], NULL, 10) : (unsigned long long)time(NULL);
+  if (n < 2 || n > MAX_NODES || samples < 2) {
+    fprintf(stderr, "Usage: %s <n_nodes 2-%d> [samples] [seed]\n", argv[0],
+            MAX_NODES);
+    fprintf(stderr, "  samples: random draws, default=%d\n", DEFAULT_SAMPLES);
+    return 1;
+  }
+
+  SampleRng rng;
+  sample_rng_seed(&rng, seed);
+  MeanStats topologies = {0}, ras = {0}, hras = {0};
+  RatioStats coverage = {0};
+  double start = wall_time_seconds();
+  for (long long s = 0; s < samples; s++) {
+    Graph g;
+    PackedGraph pg;
+
+    // Topologies: present/absent pairs
+    sample_labelled_graph(&rng, n, 2, &g);
+    graph_to_packed(&g, &pg);
+    double w = 0;
+    if (packed_is_weakly_connected(&pg) && packed_is_heritable_topology(&pg))
+      w = (double)packed_automorphism_count(&pg);
+    add_mean(&topologies, w);
+
+    // RAs and HRAs: absent/gray/black pairs
+    sample_labelled_graph(&rng, n, 3, &g);
+    graph_to_packed(&g, &pg);
+    double w_ra = 0, w_hra = 0;
+    if (packed_is_weakly_connected(&pg) &&
+        packed_is_heritable_topology(&pg)) {
+      w_ra = (double)packed_automorphism_count(&pg);
+      if (packed_is_heritable_regulatory(&pg)) {
+        w_hra = w_ra;
+        add_ratio(&coverage, w_hra, has_hra_deletion(&pg));
+      }
+    }
+    add_mean(&ras, w_ra);
+    add_mean(&hras, w_hra);
+  }
+  double elapsed = wall_time_seconds() - start;
+
+  // Labelled graphs per class of trivial symmetry
+  double pairs = (double)n * (n - 1), factorial = 1;
+  for (int i = 2; i <= n; i++)
+    factorial *= i;
+  printf("Estimates for n=%d from %lld samples (seed %llu), 95%% intervals:\n",
+         n, samples, seed);
+  print_count("Canonical topologies:", pow(2, pairs) / factorial, &topologies,
+              samples);
+  print_count("Total regulatory architectures:", pow(3, pairs) / factorial,
+              &ras, samples);
+  print_count("Heritable regulatory architectures (HRAs):",
+              pow(3, pairs) / factorial, &hras, samples);
+  printf("  %-42s %.4f +/- %.2g\n", "Expansion coverage:",
+         ratio_value(&coverage), ratio_half_width(&coverage));
+  printf("  %-42s %.0f\n", "Samples per second:",
+         elapsed > 0 ? samples / elapsed : 0.0);
+
+  // Cross-check against the reference set when there is one
+  char path[MAX_FILENAME];
+  struct stat st;
+  snprintf(path, sizeof(path), "hras_dot_files/hras_n%d.hrab", n);
+  if (stat(path, &st) != 0)
+    snprintf(path, sizeof(path), "hras_dot_files/hras_n%d.dot", n);
+  if (stat(path, &st) == 0) {
+    seed_graph_sampler(seed);
+    estimate_reference_coverage(path, samples < 10000 ? samples : 10000);
+  }
+  return 0;
+}
@@ -0,0 +1,259 @@
+// Single-step expansion library shared by hra_expander and hra_runner
+#include "hra_sampler.h"
+
+// DOT sink: provenance comment with the canonical key, then the digraph
+static void dot_sink_emit(ExpandSink *sink, const Graph *child,
+                          const char *canonical_rep, int source_id,
+                          int child_index) {
+  FILE *output = sink->ctx;
+  fprintf(output, "// Source:%d Canonical:", source_id);
+  for (int i = 0; i < child->n_nodes * child->n_nodes; i++) {
+    fprintf(output, " %d", ((const int *)canonical_rep)[i]);
+  }
+  fprintf(output, "\n");
+
+  fprintf(output, "digraph HRA_from_%d_graph_%03d {\n", source_id,
+          child_index);
+  for (int e = 0; e < child->n_edges; e++) {
+    fprintf(output, "  %d -> %d [label=\"%d\"];\n", child->edges[e].from,
+            child->edges[e].to, child->edges[e].regulation);
+  }
+  fprintf(output, "}\n\n");
+}
+
+// .hrab sink: one fixed record per child, tagged with its source
+static void hrab_sink_emit(ExpandSink *sink, const Graph *child,
+                           const char *canonical_rep, int source_id,
+                           int child_index) {
+  (void)canonical_rep;
+  (void)child_index;
+  HrabRecord rec;
+  graph_to_hrab(child, source_id, &rec);
+  hrab_write(sink->ctx, &rec);
+}
+
+ExpandSink dot_expand_sink(FILE *fp) {
+  ExpandSink sink = {dot_sink_emit, fp};
+  return sink;
+}
+
+ExpandSink hrab_expand_sink(HrabWriter *w) {
+  ExpandSink sink = {hrab_sink_emit, w};
+  return sink;
+}
+
+int expand_graph_to_file(const Graph *base, int source_id, int start_size,
+                         int target_size, const char *output_file) {
+  // Validate base graph
+  if (base->n_nodes != start_size) {
+    fprintf(stderr, "Error: Base graph has %d nodes, expected %d\n",
+            base->n_nodes, start_size);
+    return -1;
+  }
+
+  // Check weak connectivity for base graph
+  if (!is_weakly_connected(base)) {
+    fprintf(stderr, "Base graph %d is not weakly connected\n", source_id);
+    return -1;
+  }
+
+  // Output format follows the file extension
+  int graphs_generated = 0;
+  if (hrab_has_extension(output_file)) {
+    HrabWriter *w = hrab_open_writer(output_file);
+    if (!w) {
+      fprintf(stderr, "Error: Cannot open output file %s\n", output_file);
+      return -1;
+    }
+    ExpandSink sink = hrab_expand_sink(w);
+    expand_single_graph(base, target_size, &sink, &graphs_generated,
+                        source_id);
+    if (!hrab_close_writer(w)) {
+      fprintf(stderr, "Error: Failed to write %s\n", output_file);
+      return -1;
+    }
+    return graphs_generated;
+  }
+
+  FILE *output_fp = fopen(output_file, "w");
+  if (!output_fp) {
+    fprintf(stderr, "Error: Cannot open output file %s\n", output_file);
+    return -1;
+  }
+  ExpandSink sink = dot_expand_sink(output_fp);
+  expand_single_graph(base, target_size, &sink, &graphs_generated, source_id);
+  fclose(output_fp);
+  return graphs_generated;
+}
+
+// Base automorphisms kept for pattern pruning; a larger group only prunes
+// less, since every pattern class still keeps its smallest member
+#define EXPAND_MAX_AUTOS 1024
+
+// One-node extension state: the base plus the attachments chosen so far
+typedef struct {
+  Graph child; // base edges, then the new node's edges on the current path
+  int new_node;
+  bool base_valid; // base is connected and heritable, see emit_extension
+  int code[MAX_NODES];      // 3 * (in + 1) + (out + 1), in pattern order
+  int autos[EXPAND_MAX_AUTOS][PACKED_MAX_NODES]; // non-identity only
+  unsigned int stable[EXPAND_MAX_AUTOS]; // bit d: maps nodes < d onto
+                                         // themselves
+  int n_autos;
+  ExpandSink *sink;
+  int *counter;
+  int source_id;
+} Extension;
+
+// Undo the last add_edge on the shared child
+static void remove_last_edge(Graph *g) {
+  const Edge *e = &g->edges[--g->n_edges];
+  g->adj_matrix[e->from][e->to] = -1;
+  g->out_degree[e->from]--;
+  g->in_degree[e->to]--;
+}
+
+// Every pattern that reaches here gives the new node a gray in-edge, which
+// also connects it to the base. Adding a node and its edges cannot break
+// the base's connectivity or its nodes' gray in-edges, so over a connected
+// heritable base every such child is valid. Only other bases need the
+// full checks.
+static void emit_extension(Extension *x, const PackedGraph *child) {
+  if (!x->base_valid && (!packed_is_weakly_connected(child) ||
+                         !packed_is_heritable_topology(child) ||
+                         !packed_is_heritable_regulatory(child)))
+    return;
+
+  char canonical_rep[MAX_NODES * MAX_NODES * sizeof(int)];
+  memset(canonical_rep, 0, sizeof(canonical_rep));
+  canonical_rep_cached(child, (int *)canonical_rep);
+
+  x->sink->emit(x->sink, &x->child, canonical_rep, x->source_id,
+                *x->counter);
+  (*x->counter)++;
+}
+
+// An automorphism a of the base turns pattern p into the isomorphic
+// pattern q[w] = p[a[w]]. Patterns are generated in increasing order, so
+// only the smallest of each such class is kept. If a maps the first v nodes
+// onto themselves, those entries of q are already known, and once they
+// compare below p's nothing under this prefix can be the smallest.
+static bool is_smallest_prefix(const Extension *x, int v) {
+  for (int a = 0; a < x->n_autos; a++) {
+    if (!((x->stable[a] >> v) & 1))
+      continue;
+    for (int w = 0; w < v; w++) {
+      int q = x->code[x->autos[a][w]];
+      if (q != x->code[w]) {
+        if (q < x->code[w])
+          return false;
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+// Choose the attachment of existing node v and recurse. Each direction is
+// absent, gray or black, so there are 9^k patterns for k existing nodes.
+// The new node's only in-edges come from the pattern, so a pattern without
+// a gray one can never be heritable: once no later node can supply it, the
+// remaining in-labels are limited to gray.
+static void extend_from(Extension *x, const PackedGraph *g, int v,
+                        bool has_gray_in) {
+  if (v > 0 && !is_smallest_prefix(x, v))
+    return;
+  if (v == x->new_node) {
+    emit_extension(x, g);
+    return;
+  }
+  bool last = v == x->new_node - 1;
+  for (int in = -1; in <= 1; in++) {
+    if (last && !has_gray_in && in != 0)
+      continue;
+    for (int out = -1; out <= 1; out++) {
+      PackedGraph child = *g;
+      if (in >= 0) {
+        packed_add_edge(&child, v, x->new_node, in);
+        add_edge(&x->child, v, x->new_node, in);
+      }
+      if (out >= 0) {
+        packed_add_edge(&child, x->new_node, v, out);
+        add_edge(&x->child, x->new_node, v, out);
+      }
+      x->code[v] = 3 * (in + 1) + (out + 1);
+      extend_from(x, &child, v + 1, has_gray_in || in == 0);
+      if (out >= 0)
+        remove_last_edge(&x->child);
+      if (in >= 0)
+        remove_last_edge(&x->child);
+    }
+  }
+}
+
+void expand_single_graph(const Graph *base, int target_size, ExpandSink *sink,
+                         int *counter, int source_id) {
+  // Safety bounds checking
+  if (base->n_nodes >= MAX_NODES || target_size > MAX_NODES) {
+    return;
+  }
+
+  // Base case: if we've reached target size
+  if (base->n_nodes == target_size) {
+    if (is_weakly_connected(base) && is_heritable_topology(base) &&
+        is_heritable_regulatory(base)) {
+
+      // Compute canonical representation
+      char canonical_rep[MAX_NODES * MAX_NODES * sizeof(int)];
+      compute_canonical_representation(base, canonical_rep);
+
+      sink->emit(sink, base, canonical_rep, source_id, *counter);
+
+      (*counter)++;
+    }
+    return;
+  }
+
+  // Only proceed if we need exactly one more node
+  if (base->n_nodes + 1 != target_size || base->n_nodes < 1) {
+    return;
+  }
+
+  // The child Graph is the base plus the new node's edges, added and
+  // removed as the recursion moves through the patterns
+  Extension x;
+  x.new_node = base->n_nodes;
+  x.sink = sink;
+  x.counter = counter;
+  x.source_id = source_id;
+  init_graph(&x.child, x.new_node + 1);
+  for (int i = 0; i < base->n_edges; i++)
+    add_edge(&x.child, base->edges[i].from, base->edges[i].to,
+             base->edges[i].regulation);
+  PackedGraph packed_base;
+  graph_to_packed(base, &packed_base);
+  x.base_valid = packed_is_weakly_connected(&packed_base) &&
+                 packed_is_heritable_regulatory(&packed_base);
+
+  // Automorphisms of the base, found once. The identity comes first and
+  // never prunes anything, so the last one takes its place.
+  long long group = packed_automorphisms(&packed_base, x.autos,
+                                         EXPAND_MAX_AUTOS);
+  x.n_autos = group < EXPAND_MAX_AUTOS ? (int)group : EXPAND_MAX_AUTOS;
+  x.n_autos--;
+  if (x.n_autos > 0)
+    memcpy(x.autos[0], x.autos[x.n_autos], sizeof(x.autos[0]));
+  for (int a = 0; a < x.n_autos; a++) {
+    x.stable[a] = 0;
+    int reach = 0; // largest image among the first d nodes
+    for (int d = 1; d <= x.new_node; d++) {
+      if (x.autos[a][d - 1] > reach)
+        reach = x.autos[a][d - 1];
+      if (reach < d)
+        x.stable[a] |= 1u << d;
+    }
+  }
+
+  packed_base.n_nodes = (uint8_t)(x.new_node + 1);
+  extend_from(&x, &packed_base, 0, false);
+}
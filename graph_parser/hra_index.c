@@ -0,0 +1,223 @@
+// Byte-offset index for DOT graph files.
+//
+// The index lives next to the DOT file as <dot_file>.idx and holds one
+// DotIndexEntry per digraph block. It is built by a single scan the first
+// time a file is used and rebuilt whenever the DOT file's size or mtime no
+// longer match the header, so graph N can be reached with one fseek.
+#include "hra_sampler.h"
+
+#define DOT_INDEX_MAGIC "HRAIDX1"
+
+typedef struct {
+  char magic[8];
+  long long source_size;
+  long long source_mtime;
+  int count;
+  int reserved;
+} DotIndexHeader;
+
+// fseek with a 64-bit offset: long is 32 bits on Windows, and reference
+// DOT files pass 2 GB from n=5 on
+static int seek_to(FILE *fp, long long offset) {
+#if defined(_WIN32)
+  return _fseeki64(fp, offset, SEEK_SET);
+#else
+  return fseeko(fp, (off_t)offset, SEEK_SET);
+#endif
+}
+
+static void dot_index_path(const char *dot_file, char *path, size_t size) {
+  snprintf(path, size, "%s.idx", dot_file);
+}
+
+// Open the sidecar and check it still describes dot_file
+static FILE *open_fresh_index(const char *dot_file, DotIndexHeader *hdr) {
+  struct stat st;
+  if (stat(dot_file, &st) != 0)
+    return NULL;
+  char path[MAX_FILENAME];
+  dot_index_path(dot_file, path, sizeof(path));
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return NULL;
+  if (fread(hdr, sizeof(*hdr), 1, fp) != 1 ||
+      memcmp(hdr->magic, DOT_INDEX_MAGIC, sizeof(hdr->magic)) != 0 ||
+      hdr->source_size != (long long)st.st_size ||
+      hdr->source_mtime != (long long)st.st_mtime || hdr->count < 0) {
+    fclose(fp);
+    return NULL;
+  }
+  return fp;
+}
+
+// Scan dot_file once, mirroring parse_single_dot_graph
+static DotIndex *build_dot_index(const char *dot_file) {
+  FILE *fp = fopen(dot_file, "r");
+  if (!fp)
+    return NULL;
+  DotIndex *idx = malloc(sizeof(DotIndex));
+  int capacity = 1024;
+  if (idx)
+    idx->entries = malloc(capacity * sizeof(DotIndexEntry));
+  if (!idx || !idx->entries) {
+    free(idx);
+    fclose(fp);
+    return NULL;
+  }
+  idx->count = 0;
+
+  char line[MAX_LINE];
+  long long pos = 0;
+  bool in_graph = false;
+  int max_node_id = -1;
+  DotIndexEntry cur = {0, 0, 0};
+  while (fgets(line, sizeof(line), fp)) {
+    long long line_start = pos;
+    pos += (long long)strlen(line);
+    if (!in_graph && strncmp(line, "// Source:", 10) == 0)
+      continue;
+    if (!in_graph && strstr(line, "digraph")) {
+      in_graph = true;
+      cur.offset = line_start;
+      cur.n_edges = 0;
+      max_node_id = -1;
+      continue;
+    }
+    if (in_graph && strchr(line, '}')) {
+      cur.n_nodes = max_node_id + 1;
+      if (idx->count >= capacity) {
+        DotIndexEntry *tmp =
+            realloc(idx->entries, 2 * capacity * sizeof(DotIndexEntry));
+        if (!tmp) {
+          free_dot_index(idx);
+          fclose(fp);
+          return NULL;
+        }
+        idx->entries = tmp;
+        capacity *= 2;
+      }
+      idx->entries[idx->count++] = cur;
+      in_graph = false;
+      continue;
+    }
+    if (in_graph && strstr(line, "->")) {
+      int f, t, r;
+      if (sscanf(line, "%d -> %d [label=\"%d\"];", &f, &t, &r) == 3) {
+        if (cur.n_edges < MAX_EDGES)
+          cur.n_edges++;
+        if (f > max_node_id)
+          max_node_id = f;
+        if (t > max_node_id)
+          max_node_id = t;
+      }
+    }
+  }
+  fclose(fp);
+  return idx;
+}
+
+// Best effort: a read-only directory just means rebuilding next time
+static void write_dot_index(const char *dot_file, const DotIndex *idx) {
+  struct stat st;
+  if (stat(dot_file, &st) != 0)
+    return;
+  DotIndexHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, DOT_INDEX_MAGIC, sizeof(hdr.magic));
+  hdr.source_size = (long long)st.st_size;
+  hdr.source_mtime = (long long)st.st_mtime;
+  hdr.count = idx->count;
+
+  char path[MAX_FILENAME], tmp_path[MAX_FILENAME + 32];
+  dot_index_path(dot_file, path, sizeof(path));
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%d", path, (int)getpid());
+  FILE *fp = fopen(tmp_path, "wb");
+  if (!fp)
+    return;
+  bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+            fwrite(idx->entries, sizeof(DotIndexEntry), idx->count, fp) ==
+                (size_t)idx->count;
+  ok = (fclose(fp) == 0) && ok;
+  // Write-then-rename so concurrent readers never see a partial index
+  if (!ok || rename(tmp_path, path) != 0)
+    remove(tmp_path);
+}
+
+DotIndex *load_dot_index(const char *dot_file) {
+  DotIndexHeader hdr;
+  FILE *fp = open_fresh_index(dot_file, &hdr);
+  if (fp) {
+    DotIndex *idx = malloc(sizeof(DotIndex));
+    if (idx) {
+      idx->count = hdr.count;
+      idx->entries = malloc((hdr.count > 0 ? hdr.count : 1) *
+                            sizeof(DotIndexEntry));
+      if (idx->entries &&
+          fread(idx->entries, sizeof(DotIndexEntry), hdr.count, fp) ==
+              (size_t)hdr.count) {
+        fclose(fp);
+        return idx;
+      }
+      free_dot_index(idx);
+    }
+    fclose(fp);
+  }
+
+  DotIndex *idx = build_dot_index(dot_file);
+  if (idx)
+    write_dot_index(dot_file, idx);
+  return idx;
+}
+
+void free_dot_index(DotIndex *idx) {
+  if (!idx)
+    return;
+  free(idx->entries);
+  free(idx);
+}
+
+int dot_index_count(const char *dot_file) {
+  DotIndexHeader hdr;
+  FILE *fp = open_fresh_index(dot_file, &hdr);
+  if (fp) {
+    fclose(fp);
+    return hdr.count;
+  }
+  DotIndex *idx = load_dot_index(dot_file);
+  if (!idx)
+    return -1;
+  int count = idx->count;
+  free_dot_index(idx);
+  return count;
+}
+
+bool dot_index_entry(const char *dot_file, int graph_index,
+                     DotIndexEntry *entry) {
+  if (graph_index < 0)
+    return false;
+  DotIndexHeader hdr;
+  FILE *fp = open_fresh_index(dot_file, &hdr);
+  if (fp) {
+    long long offset =
+        (long long)sizeof(hdr) + (long long)graph_index * sizeof(DotIndexEntry);
+    bool ok = graph_index < hdr.count && seek_to(fp, offset) == 0 &&
+              fread(entry, sizeof(DotIndexEntry), 1, fp) == 1;
+    fclose(fp);
+    return ok;
+  }
+  DotIndex *idx = load_dot_index(dot_file);
+  if (!idx)
+    return false;
+  bool ok = graph_index < idx->count;
+  if (ok)
+    *entry = idx->entries[graph_index];
+  free_dot_index(idx);
+  return ok;
+}
+
+bool read_dot_graph_at(FILE *fp, const DotIndexEntry *entry, Graph *g,
+                       int *graph_id) {
+  if (seek_to(fp, entry->offset) != 0)
+    return false;
+  return parse_single_dot_graph(fp, g, graph_id, NULL);
+}
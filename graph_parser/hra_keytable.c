@@ -0,0 +1,115 @@
+// Open-addressing slot table over canonical keys.
+//
+// Shared by the reference index (hra_refindex.c) and the canonical cache
+// (hra_canon_cache.c), which both store it in their files as a key array
+// followed by its slot table, and read it back as is. Keys are hashed with
+// FNV-1a and compared on CANON_KEY_BYTES, so the source field can carry a
+// payload. The slot table is a power of two at least twice the key count,
+// probed linearly.
+#include "hra_sampler.h"
+
+unsigned long long canon_key_hash(const HrabRecord *key) {
+  const unsigned char *p = (const unsigned char *)key;
+  unsigned long long h = 1469598103934665603ULL;
+  for (size_t i = 0; i < CANON_KEY_BYTES; i++) {
+    h ^= p[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+int key_table_slot_capacity(int count) {
+  int cap = 2;
+  while (cap / 2 < count)
+    cap *= 2;
+  return cap;
+}
+
+bool key_table_init(KeyTable *t, int capacity) {
+  memset(t, 0, sizeof(*t));
+  t->keys = malloc((capacity > 0 ? capacity : 1) * sizeof(HrabRecord));
+  if (!t->keys)
+    return false;
+  t->capacity = capacity;
+  if (!key_table_rehash(t, key_table_slot_capacity(capacity))) {
+    key_table_free(t);
+    return false;
+  }
+  return true;
+}
+
+int key_table_probe(const KeyTable *t, const HrabRecord *key) {
+  unsigned long long mask = (unsigned long long)t->slot_capacity - 1;
+  unsigned long long s = canon_key_hash(key) & mask;
+  while (t->slots[s] != -1 &&
+         memcmp(&t->keys[t->slots[s]], key, CANON_KEY_BYTES) != 0)
+    s = (s + 1) & mask;
+  return (int)s;
+}
+
+int key_table_find(const KeyTable *t, const HrabRecord *key) {
+  if (t->slot_capacity == 0)
+    return -1;
+  return t->slots[key_table_probe(t, key)];
+}
+
+bool key_table_rehash(KeyTable *t, int slot_capacity) {
+  int *slots = malloc(slot_capacity * sizeof(int));
+  if (!slots)
+    return false;
+  for (int i = 0; i < slot_capacity; i++)
+    slots[i] = -1;
+  free(t->slots);
+  t->slots = slots;
+  t->slot_capacity = slot_capacity;
+  for (int i = 0; i < t->count; i++)
+    t->slots[key_table_probe(t, &t->keys[i])] = i;
+  return true;
+}
+
+bool key_table_add(KeyTable *t, const HrabRecord *key) {
+  if (t->count >= t->capacity) {
+    int nc = t->capacity ? 2 * t->capacity : 1024;
+    HrabRecord *tmp = realloc(t->keys, nc * sizeof(HrabRecord));
+    if (!tmp)
+      return false;
+    t->keys = tmp;
+    t->capacity = nc;
+  }
+  if (2 * (t->count + 1) > t->slot_capacity &&
+      !key_table_rehash(t, key_table_slot_capacity(t->count + 1)))
+    return false;
+  t->keys[t->count] = *key;
+  t->slots[key_table_probe(t, key)] = t->count++;
+  return true;
+}
+
+// Every slot is empty or names a key, and each key has exactly one slot.
+// That also leaves at least one empty slot, so probing always stops.
+bool key_table_valid(const KeyTable *t) {
+  if (t->slot_capacity < 2 || (t->slot_capacity & (t->slot_capacity - 1)) ||
+      t->slot_capacity / 2 < t->count)
+    return false;
+  bool *seen = calloc(t->count > 0 ? t->count : 1, sizeof(bool));
+  if (!seen)
+    return false;
+  bool ok = true;
+  int used = 0;
+  for (int s = 0; ok && s < t->slot_capacity; s++) {
+    int k = t->slots[s];
+    if (k == -1)
+      continue;
+    ok = k >= 0 && k < t->count && !seen[k];
+    if (ok)
+      seen[k] = true;
+    used++;
+  }
+  free(seen);
+  return ok && used == t->count;
+}
+
+void key_table_free(KeyTable *t) {
+  free(t->keys);
+  free(t->slots);
+  memset(t, 0, sizeof(*t));
+}
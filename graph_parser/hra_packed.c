@@ -0,0 +1,304 @@
+// Packed graph construction, validity checks and canonical labeling
+#include "hra_packed.h"
+#include <string.h>
+
+void packed_init(PackedGraph *pg, int n_nodes) {
+  memset(pg, 0, sizeof(*pg));
+  pg->n_nodes = (uint8_t)n_nodes;
+}
+
+void packed_add_edge(PackedGraph *pg, int from, int to, int regulation) {
+  pg->out[from] |= (NodeMask)(1u << to);
+  pg->in[to] |= (NodeMask)(1u << from);
+  if (regulation == 1)
+    pg->black[from] |= (NodeMask)(1u << to);
+  pg->n_edges++;
+}
+
+int packed_edge(const PackedGraph *pg, int from, int to) {
+  if (!((pg->out[from] >> to) & 1))
+    return -1;
+  return (pg->black[from] >> to) & 1;
+}
+
+void packed_from_adjacency(PackedGraph *pg, int n_nodes, const int *adj,
+                           int stride) {
+  packed_init(pg, n_nodes);
+  for (int i = 0; i < n_nodes; i++)
+    for (int j = 0; j < n_nodes; j++)
+      if (adj[i * stride + j] >= 0)
+        packed_add_edge(pg, i, j, adj[i * stride + j]);
+}
+
+// Canonical labeling by ordered partition refinement.
+//
+// The key is the lexicographically minimal row-major adjacency matrix over all
+// node relabelings, with entries ordered the way memcmp orders the ints
+// (0 < 1 < -1).  Instead of trying all n! permutations the positions are
+// filled in order: the node placed at position k has to come from the cell
+// covering k, and once it is placed every remaining cell is split by that
+// node's out-labels (gray, black, none), which is exactly the ordering that
+// minimises row k.  Starting from a single cell, the first split groups nodes
+// by out-degree and label counts, and each later split refines the cells by
+// the labels towards the nodes already placed.  We only individualize (branch)
+// when several candidates give the same row, and skip candidates that are
+// images of explored ones under automorphisms found at the leaves.
+
+#define CANON_MAX_AUTOS 64
+
+typedef struct {
+  int n;
+  const PackedGraph *g;
+  unsigned char cur[PACKED_MAX_NODES * PACKED_MAX_NODES];
+  unsigned char best[PACKED_MAX_NODES * PACKED_MAX_NODES];
+  int best_perm[PACKED_MAX_NODES];
+  bool has_best;
+  int autos[CANON_MAX_AUTOS][PACKED_MAX_NODES];
+  int n_autos;
+} CanonSearch;
+
+// Label of v -> u as a key entry rank: 0 gray, 1 black, 2 no edge
+static inline unsigned char canon_rank(const PackedGraph *g, int v, int u) {
+  if (!((g->out[v] >> u) & 1))
+    return 2;
+  return (g->black[v] >> u) & 1;
+}
+
+static int canon_uf_find(int *parent, int x) {
+  while (parent[x] != x)
+    x = parent[x] = parent[parent[x]];
+  return x;
+}
+
+// Place v at position k and split the remaining cells by v's out-labels.
+// Fills the refined ordering and the resulting row k of the key.
+static void canon_refine(const CanonSearch *cs, int k, const int *order,
+                         const bool *starts, int v, int *out_order,
+                         bool *out_starts, unsigned char *row) {
+  int n = cs->n;
+  for (int i = 0; i < k; i++) {
+    out_order[i] = order[i];
+    out_starts[i] = true;
+    row[i] = canon_rank(cs->g, v, order[i]);
+  }
+  out_order[k] = v;
+  out_starts[k] = true;
+  row[k] = canon_rank(cs->g, v, v);
+
+  int p = k + 1;
+  for (int s = k; s < n;) {
+    int e = s + 1;
+    while (e < n && !starts[e])
+      e++;
+    for (unsigned char b = 0; b < 3; b++) {
+      bool first = true;
+      for (int i = s; i < e; i++) {
+        int u = order[i];
+        if (u == v || canon_rank(cs->g, v, u) != b)
+          continue;
+        out_order[p] = u;
+        out_starts[p] = first;
+        row[p] = b;
+        first = false;
+        p++;
+      }
+    }
+    s = e;
+  }
+}
+
+// Returns -1 to continue normally, or the depth the search should unwind to
+// after a leaf proved two branches equivalent.
+static int canon_search(CanonSearch *cs, int k, const int *order,
+                        const bool *starts) {
+  int n = cs->n;
+  if (k == n) {
+    if (!cs->has_best) {
+      memcpy(cs->best, cs->cur, n * n);
+      memcpy(cs->best_perm, order, n * sizeof(int));
+      cs->has_best = true;
+      return -1;
+    }
+    // Same key as the best leaf: best_perm[i] -> order[i] is an automorphism
+    if (cs->n_autos < CANON_MAX_AUTOS) {
+      for (int i = 0; i < n; i++)
+        cs->autos[cs->n_autos][cs->best_perm[i]] = order[i];
+      cs->n_autos++;
+    }
+    int j = 0;
+    while (j < n && order[j] == cs->best_perm[j])
+      j++;
+    return j;
+  }
+
+  int end = k + 1;
+  while (end < n && !starts[end])
+    end++;
+  int n_cand = end - k;
+
+  int child[PACKED_MAX_NODES][PACKED_MAX_NODES];
+  bool child_starts[PACKED_MAX_NODES][PACKED_MAX_NODES];
+  unsigned char rows[PACKED_MAX_NODES][PACKED_MAX_NODES];
+  int min_c = 0;
+  for (int c = 0; c < n_cand; c++) {
+    canon_refine(cs, k, order, starts, order[k + c], child[c], child_starts[c],
+                 rows[c]);
+    if (memcmp(rows[c], rows[min_c], n) < 0)
+      min_c = c;
+  }
+
+  if (cs->has_best) {
+    int cmp = memcmp(rows[min_c], cs->best + k * n, n);
+    if (cmp > 0)
+      return -1;
+    if (cmp < 0)
+      cs->has_best = false;
+  }
+  memcpy(cs->cur + k * n, rows[min_c], n);
+
+  int explored[PACKED_MAX_NODES];
+  int n_explored = 0;
+  for (int c = 0; c < n_cand; c++) {
+    if (memcmp(rows[c], rows[min_c], n) != 0)
+      continue;
+    int v = order[k + c];
+
+    // Skip v if a known automorphism fixing the prefix maps an explored
+    // candidate onto it.
+    if (n_explored > 0 && cs->n_autos > 0) {
+      int parent[PACKED_MAX_NODES];
+      for (int i = 0; i < n; i++)
+        parent[i] = i;
+      for (int a = 0; a < cs->n_autos; a++) {
+        bool fixes = true;
+        for (int i = 0; i < k && fixes; i++)
+          fixes = cs->autos[a][order[i]] == order[i];
+        if (!fixes)
+          continue;
+        for (int i = 0; i < n; i++) {
+          int r1 = canon_uf_find(parent, i);
+          int r2 = canon_uf_find(parent, cs->autos[a][i]);
+          if (r1 != r2)
+            parent[r1] = r2;
+        }
+      }
+      bool equivalent = false;
+      for (int x = 0; x < n_explored && !equivalent; x++)
+        equivalent = canon_uf_find(parent, explored[x]) ==
+                     canon_uf_find(parent, v);
+      if (equivalent)
+        continue;
+    }
+
+    explored[n_explored++] = v;
+    int r = canon_search(cs, k + 1, child[c], child_starts[c]);
+    if (r >= 0 && r < k)
+      return r;
+  }
+  return -1;
+}
+
+void packed_canonical_rep(const PackedGraph *pg, int *canon) {
+  packed_canonical_labeling(pg, canon, NULL);
+}
+
+void packed_canonical_labeling(const PackedGraph *pg, int *canon, int *lab) {
+  int n = pg->n_nodes;
+  if (n <= 0 || n > PACKED_MAX_NODES)
+    return;
+
+  CanonSearch cs;
+  cs.n = n;
+  cs.g = pg;
+  cs.has_best = false;
+  cs.n_autos = 0;
+
+  int order[PACKED_MAX_NODES];
+  bool starts[PACKED_MAX_NODES];
+  for (int i = 0; i < n; i++) {
+    order[i] = i;
+    starts[i] = (i == 0);
+  }
+  canon_search(&cs, 0, order, starts);
+
+  for (int i = 0; i < n * n; i++)
+    canon[i] = (cs.best[i] == 2) ? -1 : cs.best[i];
+  if (lab)
+    memcpy(lab, cs.best_perm, n * sizeof(int));
+}
+
+// Automorphism counting by plain backtracking: node i may map to v only if
+// their label degrees agree and every edge to the nodes mapped so far keeps
+// its label. Sampled graphs rarely have large groups, so no refinement.
+
+static int packed_popcount(unsigned int mask) {
+#if defined(__GNUC__)
+  return __builtin_popcount(mask);
+#else
+  int count = 0;
+  for (; mask; mask &= mask - 1)
+    count++;
+  return count;
+#endif
+}
+
+typedef struct {
+  const PackedGraph *g;
+  int signature[PACKED_MAX_NODES];
+  int perm[PACKED_MAX_NODES];
+  int (*perms)[PACKED_MAX_NODES]; // where to store the first max_perms
+  long long max_perms;
+  long long found;
+} AutoCount;
+
+static long long count_extensions(AutoCount *ac, int i, NodeMask used) {
+  const PackedGraph *g = ac->g;
+  int n = g->n_nodes;
+  if (i == n) {
+    if (ac->found < ac->max_perms)
+      memcpy(ac->perms[ac->found], ac->perm, n * sizeof(int));
+    ac->found++;
+    return 1;
+  }
+  long long count = 0;
+  for (int v = 0; v < n; v++) {
+    if (((used >> v) & 1) || ac->signature[v] != ac->signature[i])
+      continue;
+    bool ok = true;
+    for (int j = 0; j < i && ok; j++)
+      ok = canon_rank(g, i, j) == canon_rank(g, v, ac->perm[j]) &&
+           canon_rank(g, j, i) == canon_rank(g, ac->perm[j], v);
+    if (!ok)
+      continue;
+    ac->perm[i] = v;
+    count += count_extensions(ac, i + 1, (NodeMask)(used | (1u << v)));
+  }
+  return count;
+}
+
+long long packed_automorphism_count(const PackedGraph *pg) {
+  return packed_automorphisms(pg, NULL, 0);
+}
+
+long long packed_automorphisms(const PackedGraph *pg,
+                               int (*perms)[PACKED_MAX_NODES], int max_perms) {
+  int n = pg->n_nodes;
+  if (n <= 0 || n > PACKED_MAX_NODES)
+    return 0;
+  AutoCount ac;
+  ac.g = pg;
+  ac.perms = perms;
+  ac.max_perms = perms ? max_perms : 0;
+  ac.found = 0;
+  NodeMask black_in[PACKED_MAX_NODES] = {0};
+  for (int i = 0; i < n; i++)
+    for (unsigned int m = pg->black[i]; m; m &= m - 1)
+      black_in[packed_lowest_node(m)] |= (NodeMask)(1u << i);
+  // Out, in, black-out and black-in degrees, each below 16
+  for (int i = 0; i < n; i++)
+    ac.signature[i] = packed_popcount(pg->out[i]) |
+                      packed_popcount(pg->in[i]) << 4 |
+                      packed_popcount(pg->black[i]) << 8 |
+                      packed_popcount(black_in[i]) << 12;
+  return count_extensions(&ac, 0, 0);
+}
@@ -0,0 +1,101 @@
+#ifndef HRA_PACKED_H
+#define HRA_PACKED_H
+
+// Bit-packed graph used by the enumeration and expansion inner loops.
+//
+// Each node keeps its out- and in-neighbourhoods as 16-bit masks, and black
+// (label 1) edges are marked in a separate mask per source node, so a whole
+// graph is 62 bytes instead of the ~1.3 KB Graph struct and fits in one
+// cache line. Like the .hrab format it does not depend on either Graph
+// struct; both tool families convert from their adj_matrix.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PACKED_MAX_NODES 10
+
+typedef uint16_t NodeMask;
+
+typedef struct {
+  uint8_t n_nodes;
+  uint8_t n_edges;
+  NodeMask out[PACKED_MAX_NODES];   // bit j of out[i]: edge i -> j
+  NodeMask in[PACKED_MAX_NODES];    // bit i of in[j]: edge i -> j
+  NodeMask black[PACKED_MAX_NODES]; // bit j of black[i]: i -> j is black
+} PackedGraph;
+
+void packed_init(PackedGraph *pg, int n_nodes);
+void packed_add_edge(PackedGraph *pg, int from, int to, int regulation);
+int packed_edge(const PackedGraph *pg, int from, int to); // -1, 0 or 1
+
+// adj is row-major with the given stride; -1 means no edge, 0 gray, 1 black
+void packed_from_adjacency(PackedGraph *pg, int n_nodes, const int *adj,
+                           int stride);
+
+// Validity checks, bit-parallel over the masks. They are inline because
+// they sit on the innermost enumeration paths.
+static inline NodeMask packed_all_nodes(const PackedGraph *pg) {
+  return (NodeMask)((1u << pg->n_nodes) - 1);
+}
+
+// Index of the lowest set bit; mask must be non-zero
+static inline int packed_lowest_node(unsigned int mask) {
+#if defined(__GNUC__)
+  return __builtin_ctz(mask);
+#else
+  int v = 0;
+  while (!((mask >> v) & 1))
+    v++;
+  return v;
+#endif
+}
+
+// Grow the set reached from node 0 along edges in either direction
+static inline bool packed_is_weakly_connected(const PackedGraph *pg) {
+  if (pg->n_nodes <= 1)
+    return true;
+  NodeMask reached = 1;
+  unsigned int frontier = 1;
+  while (frontier) {
+    int v = packed_lowest_node(frontier);
+    frontier &= frontier - 1;
+    NodeMask next = (NodeMask)((pg->out[v] | pg->in[v]) & ~reached);
+    reached |= next;
+    frontier |= next;
+  }
+  return reached == packed_all_nodes(pg);
+}
+
+// Every node has an in-edge: the out-masks together cover all nodes
+static inline bool packed_is_heritable_topology(const PackedGraph *pg) {
+  NodeMask targets = 0;
+  for (int i = 0; i < pg->n_nodes; i++)
+    targets |= pg->out[i];
+  return targets == packed_all_nodes(pg);
+}
+
+// Every node has a gray in-edge: same union over the gray out-edges
+static inline bool packed_is_heritable_regulatory(const PackedGraph *pg) {
+  NodeMask gray_targets = 0;
+  for (int i = 0; i < pg->n_nodes; i++)
+    gray_targets |= pg->out[i] & ~pg->black[i];
+  return gray_targets == packed_all_nodes(pg);
+}
+
+// Canonical key: the lexicographically minimal row-major n x n adjacency
+// (-1, 0, 1 ints, compared with memcmp) over all node relabelings. Files
+// that store canonical keys record PACKED_CANON_VERSION; bump it whenever
+// the key of any graph changes.
+#define PACKED_CANON_VERSION 1
+void packed_canonical_rep(const PackedGraph *pg, int *canon);
+// Same key; lab[i] is the node placed at position i of the key
+void packed_canonical_labeling(const PackedGraph *pg, int *canon, int *lab);
+
+// Number of label-preserving node permutations, identity included
+long long packed_automorphism_count(const PackedGraph *pg);
+// Same count; also stores the first max_perms of them in perms, perm[i]
+// being the image of node i. The identity comes first.
+long long packed_automorphisms(const PackedGraph *pg,
+                               int (*perms)[PACKED_MAX_NODES], int max_perms);
+
+#endif // HRA_PACKED_H
@@ -0,0 +1,221 @@
+// Streaming expand -> canonicalize -> dedup pipeline for hra_runner
+// (--pipeline).
+//
+// Expander threads push each child's canonical key, with its source id, into
+// their own bounded single-producer/single-consumer ring. The main thread is
+// the dedup stage: it drains the rings into the same UniqueGraphSets that
+// analyze_results builds, while expansion is still running. No result files
+// are written and nothing is parsed or canonicalized twice, so the summary
+// is ready as soon as the last worker finishes.
+#include "hra_sampler.h"
+#include <sched.h>
+
+#define KEY_QUEUE_SIZE 4096 // records per ring, a power of two
+#define QUEUE_SPIN_LIMIT 64 // empty polls that only yield before sleeping
+#define QUEUE_SLEEP_NS 50000
+
+// Ring indices only grow; slot = index & (KEY_QUEUE_SIZE - 1). tail is
+// written by the producer and head by the consumer, each published with
+// release stores and read with acquire loads, so no lock is needed.
+typedef struct {
+  HrabRecord slots[KEY_QUEUE_SIZE];
+  unsigned int head;
+  char pad[60]; // keep head and tail on separate cache lines
+  unsigned int tail;
+  int done;
+  long long stalls; // pushes that found the ring full
+} KeyQueue;
+
+#if defined(__GNUC__)
+#define QUEUE_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define QUEUE_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+#error "the pipeline queues need GCC-style __atomic builtins"
+#endif
+
+// One wait step of a stage that found nothing to do; spins counts its
+// consecutive failed polls. A short wait only yields; a longer one sleeps,
+// so a stalled stage leaves its core to the running threads.
+static void queue_backoff(int *spins) {
+  if (++*spins <= QUEUE_SPIN_LIMIT) {
+    sched_yield();
+    return;
+  }
+  struct timespec ts = {0, QUEUE_SLEEP_NS};
+  nanosleep(&ts, NULL);
+}
+
+static void key_queue_push(KeyQueue *q, const HrabRecord *rec) {
+  unsigned int tail = q->tail;
+  if (tail - QUEUE_LOAD(&q->head) == KEY_QUEUE_SIZE) {
+    q->stalls++;
+    int spins = 0;
+    while (tail - QUEUE_LOAD(&q->head) == KEY_QUEUE_SIZE)
+      queue_backoff(&spins);
+  }
+  q->slots[tail & (KEY_QUEUE_SIZE - 1)] = *rec;
+  QUEUE_STORE(&q->tail, tail + 1);
+}
+
+// Moves up to max records out of q; returns how many
+static int key_queue_pop(KeyQueue *q, HrabRecord *out, int max) {
+  unsigned int head = q->head;
+  unsigned int available = QUEUE_LOAD(&q->tail) - head;
+  int count = available < (unsigned int)max ? (int)available : max;
+  for (int i = 0; i < count; i++)
+    out[i] = q->slots[(head + i) & (KEY_QUEUE_SIZE - 1)];
+  if (count > 0)
+    QUEUE_STORE(&q->head, head + count);
+  return count;
+}
+
+typedef struct {
+  WorkerThread *worker; // input, queue and thread id
+  KeyQueue *keys;
+  int processed;
+  int failed;
+} PipelineWorker;
+
+// Canonical key (already computed by the expansion) and source id
+static void pipeline_sink_emit(ExpandSink *sink, const Graph *child,
+                               const char *canonical_rep, int source_id,
+                               int child_index) {
+  (void)child_index;
+  HrabRecord rec;
+  int n = child->n_nodes;
+  hrab_encode(&rec, n, (const int *)canonical_rep, n, source_id);
+  key_queue_push(sink->ctx, &rec);
+}
+
+static void *pipeline_worker(void *arg) {
+  PipelineWorker *pw = arg;
+  WorkerThread *worker = pw->worker;
+  FILE *input_fp = NULL;
+  if (!worker->input_hrab)
+    input_fp = fopen(worker->input_dot_file, "r");
+  ExpandSink sink = {pipeline_sink_emit, pw->keys};
+  int begin, end;
+  bool stolen;
+  while ((worker->input_hrab || input_fp) &&
+         next_work_chunk(worker->queue, worker->thread_id, &begin, &end,
+                         &stolen)) {
+    for (int idx = begin; idx < end; idx++) {
+      Graph base;
+      int graph_id = 0;
+      if (worker->input_hrab)
+        hrab_to_graph(&worker->input_hrab->records[idx], &base);
+      else if (!read_dot_graph_at(input_fp, &worker->input_index->entries[idx],
+                                  &base, &graph_id)) {
+        pw->failed++;
+        continue;
+      }
+      if (base.n_nodes != worker->start_node_count ||
+          !is_weakly_connected(&base)) {
+        pw->failed++;
+        continue;
+      }
+      int generated = 0;
+      expand_single_graph(&base, worker->target_node_count, &sink, &generated,
+                          idx);
+      pw->processed++;
+    }
+  }
+  if (!worker->input_hrab && !input_fp)
+    pw->failed = -1;
+  if (input_fp)
+    fclose(input_fp);
+  QUEUE_STORE(&pw->keys->done, 1);
+  return NULL;
+}
+
+// Dedup stage: feed one record into the analysis sets
+static void record_key(UniqueGraphSet *all_unique,
+                       UniqueGraphSet *from_sources, const HrabRecord *rec) {
+  // Same buffer compute_canonical_representation fills
+  char canonical_rep[MAX_NODES * MAX_NODES * sizeof(int)];
+  memset(canonical_rep, 0, sizeof(canonical_rep));
+  int n = hrab_node_count(rec);
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+      ((int *)canonical_rep)[i * n + j] = hrab_edge(rec, i, j);
+  char source_tag[64];
+  snprintf(source_tag, sizeof(source_tag), "Source:%d", hrab_source(rec));
+  add_unique_graph(all_unique, canonical_rep, source_tag);
+  add_unique_graph(from_sources, canonical_rep, source_tag);
+}
+
+// args[0..num_threads-1] are filled in as for worker_thread
+int run_pipeline(WorkerThread *args, int num_threads) {
+  pthread_t threads[MAX_THREADS];
+  PipelineWorker workers[MAX_THREADS];
+  KeyQueue *queues = calloc(num_threads, sizeof(KeyQueue));
+  UniqueGraphSet *all_unique = create_unique_graph_set(1024);
+  UniqueGraphSet *from_sources = create_unique_graph_set(1024);
+  if (!queues || !all_unique || !from_sources) {
+    free(queues);
+    free_unique_graph_set(all_unique);
+    free_unique_graph_set(from_sources);
+    return -1;
+  }
+
+  int started = 0;
+  for (int i = 0; i < num_threads; i++) {
+    workers[i].worker = &args[i];
+    workers[i].keys = &queues[i];
+    workers[i].processed = 0;
+    workers[i].failed = 0;
+    if (pthread_create(&threads[i], NULL, pipeline_worker, &workers[i]) !=
+        0) {
+      perror("Failed to create thread");
+      break;
+    }
+    started++;
+  }
+
+  // Drain the rings until every producer has finished and its ring is empty
+  HrabRecord batch[256];
+  long long keys = 0;
+  int finished = 0, spins = 0;
+  while (finished < started) {
+    finished = 0;
+    bool idle = true;
+    for (int i = 0; i < started; i++) {
+      // Read done before draining, so nothing pushed before it is missed
+      bool done = QUEUE_LOAD(&queues[i].done);
+      int got = key_queue_pop(&queues[i], batch, 256);
+      for (int k = 0; k < got; k++)
+        record_key(all_unique, from_sources, &batch[k]);
+      keys += got;
+      if (got > 0)
+        idle = false;
+      else if (done)
+        finished++;
+    }
+    if (!idle)
+      spins = 0;
+    else if (finished < started)
+      queue_backoff(&spins);
+  }
+
+  int processed = 0, failed = 0;
+  long long stalls = 0;
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+    processed += workers[i].processed;
+    failed += workers[i].failed > 0 ? workers[i].failed : 0;
+    stalls += queues[i].stalls;
+    if (workers[i].failed < 0)
+      fprintf(stderr, "Thread %d: Error - cannot open %s\n", i,
+              args[i].input_dot_file);
+  }
+  printf("Pipeline: %d source graphs expanded (%d skipped), %lld keys "
+         "deduplicated, %lld full-queue stalls\n",
+         processed, failed, keys, stalls);
+  report_analysis(all_unique, from_sources, args[0].start_node_count,
+                  args[0].target_node_count);
+
+  free(queues);
+  free_unique_graph_set(all_unique);
+  free_unique_graph_set(from_sources);
+  return started == num_threads ? 0 : -1;
+}
@@ -0,0 +1,177 @@
+// Hashed canonical index of a reference set.
+//
+// The index lives next to the reference file as <file>.canon. It holds the
+// canonical key of every reference graph as an .hrab record, whose source
+// field is the graph's position in the file, followed by an open-addressing
+// slot table over those keys. It is built by canonicalizing the reference
+// once and is rebuilt whenever the reference's size or mtime no longer
+// match the header, like the DOT offset index, or the canonical form
+// version has changed. Later runs read it back as is, so membership tests
+// need no canonicalization of the reference.
+#include "hra_sampler.h"
+
+#define CANON_INDEX_MAGIC "HRACAN2"
+
+typedef struct {
+  char magic[8];
+  int canon_version; // PACKED_CANON_VERSION
+  long long source_size;
+  long long source_mtime;
+  int count;
+  int slot_capacity;
+} CanonIndexHeader;
+
+static void canon_index_path(const char *ref_file, char *path, size_t size) {
+  snprintf(path, size, "%s.canon", ref_file);
+}
+
+int canon_index_find(const CanonIndex *ci, const HrabRecord *key) {
+  int k = key_table_find(ci, key);
+  return k < 0 ? -1 : hrab_source(&ci->keys[k]);
+}
+
+void free_canon_index(CanonIndex *ci) {
+  if (!ci)
+    return;
+  key_table_free(ci);
+  free(ci);
+}
+
+// Canonicalize every graph of ref_file. A class listed twice keeps its
+// first position.
+static CanonIndex *build_canon_index(const char *ref_file) {
+  bool binary = hrab_has_extension(ref_file);
+  HrabFile *hf = NULL;
+  DotIndex *di = NULL;
+  FILE *fp = NULL;
+  int total = 0;
+  if (binary) {
+    hf = hrab_open(ref_file);
+    total = hf ? (int)hf->count : -1;
+  } else {
+    di = load_dot_index(ref_file);
+    fp = fopen(ref_file, "r");
+    total = di && fp ? di->count : -1;
+  }
+  CanonIndex *ci = total >= 0 ? malloc(sizeof(CanonIndex)) : NULL;
+  bool ok = ci && key_table_init(ci, total);
+  if (ci && !ok) {
+    free(ci);
+    ci = NULL;
+  }
+  for (int i = 0; ok && i < total; i++) {
+    Graph g;
+    int graph_id = 0;
+    if (binary)
+      hrab_to_graph(&hf->records[i], &g);
+    else
+      ok = read_dot_graph_at(fp, &di->entries[i], &g, &graph_id);
+    if (!ok)
+      break;
+    int canon[MAX_NODES * MAX_NODES];
+    PackedGraph pg;
+    graph_to_packed(&g, &pg);
+    canonical_rep_cached(&pg, canon);
+    HrabRecord key;
+    hrab_encode(&key, g.n_nodes, canon, g.n_nodes, i);
+    if (key_table_find(ci, &key) < 0)
+      ok = key_table_add(ci, &key);
+  }
+  hrab_close(hf);
+  free_dot_index(di);
+  if (fp)
+    fclose(fp);
+  if (!ok) {
+    free_canon_index(ci);
+    return NULL;
+  }
+  return ci;
+}
+
+// Best effort, write-then-rename as for the offset index
+static void write_canon_index(const char *ref_file, const CanonIndex *ci) {
+  struct stat st;
+  if (stat(ref_file, &st) != 0)
+    return;
+  CanonIndexHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, CANON_INDEX_MAGIC, sizeof(hdr.magic));
+  hdr.canon_version = PACKED_CANON_VERSION;
+  hdr.source_size = (long long)st.st_size;
+  hdr.source_mtime = (long long)st.st_mtime;
+  hdr.count = ci->count;
+  hdr.slot_capacity = ci->slot_capacity;
+
+  char path[MAX_FILENAME], tmp_path[MAX_FILENAME + 32];
+  canon_index_path(ref_file, path, sizeof(path));
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%d", path, (int)getpid());
+  FILE *fp = fopen(tmp_path, "wb");
+  if (!fp)
+    return;
+  bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+            fwrite(ci->keys, sizeof(HrabRecord), ci->count, fp) ==
+                (size_t)ci->count &&
+            fwrite(ci->slots, sizeof(int), ci->slot_capacity, fp) ==
+                (size_t)ci->slot_capacity;
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok || rename(tmp_path, path) != 0)
+    remove(tmp_path);
+}
+
+// The stored index, if it still describes ref_file and is intact: exactly
+// the header, keys and slots, with every slot in range
+static CanonIndex *read_canon_index(const char *ref_file) {
+  struct stat st;
+  if (stat(ref_file, &st) != 0)
+    return NULL;
+  char path[MAX_FILENAME];
+  canon_index_path(ref_file, path, sizeof(path));
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return NULL;
+  CanonIndexHeader hdr;
+  CanonIndex *ci = NULL;
+  if (fread(&hdr, sizeof(hdr), 1, fp) == 1 &&
+      memcmp(hdr.magic, CANON_INDEX_MAGIC, sizeof(hdr.magic)) == 0 &&
+      hdr.canon_version == PACKED_CANON_VERSION &&
+      hdr.source_size == (long long)st.st_size &&
+      hdr.source_mtime == (long long)st.st_mtime && hdr.count >= 0 &&
+      hdr.slot_capacity >= 2 && hdr.slot_capacity / 2 >= hdr.count &&
+      (hdr.slot_capacity & (hdr.slot_capacity - 1)) == 0)
+    ci = calloc(1, sizeof(CanonIndex));
+  if (ci) {
+    ci->keys = malloc((hdr.count > 0 ? hdr.count : 1) * sizeof(HrabRecord));
+    ci->slots = malloc(hdr.slot_capacity * sizeof(int));
+    ci->count = ci->capacity = hdr.count;
+    ci->slot_capacity = hdr.slot_capacity;
+    if (!ci->keys || !ci->slots ||
+        fread(ci->keys, sizeof(HrabRecord), hdr.count, fp) !=
+            (size_t)hdr.count ||
+        fread(ci->slots, sizeof(int), hdr.slot_capacity, fp) !=
+            (size_t)hdr.slot_capacity ||
+        fgetc(fp) != EOF || !key_table_valid(ci)) {
+      free_canon_index(ci);
+      ci = NULL;
+    }
+  }
+  fclose(fp);
+  return ci;
+}
+
+CanonIndex *load_canon_index(const char *ref_file) {
+  CanonIndex *ci = read_canon_index(ref_file);
+  if (ci)
+    return ci;
+  ci = build_canon_index(ref_file);
+  if (ci)
+    write_canon_index(ref_file, ci);
+  return ci;
+}
+
+// found classes were produced and covered of them are in ci: the
+// intersection with the reference and both differences
+void print_reference_coverage(const CanonIndex *ci, int n, int covered,
+                              int found) {
+  printf("Reference hras_n%d (exact): %d covered, %d missing, %d extraneous\n",
+         n, covered, ci->count - covered, found - covered);
+}
@@ -0,0 +1,276 @@
+// Reverse coverage for hra_runner (--reverse).
+//
+// A size-(n+1) graph comes out of the one-node expansion of a size-n source
+// exactly when deleting one of its nodes leaves a graph isomorphic to that
+// source. So instead of generating and deduplicating every forward child,
+// each graph of the target reference set has each node deleted in turn and
+// the result looked up in the canonically sorted sources. That is n+1
+// canonicalizations per reference graph, and it yields the exact parent
+// list of every target, written to reverse_n<k>.csv in the results
+// directory.
+#include "hra_sampler.h"
+
+typedef struct {
+  HrabRecord key; // canonical form, source field zero
+  int source;     // index in the source file
+} SourceKey;
+
+typedef struct {
+  int thread_id;
+  const SourceKey *sources;
+  int n_sources;
+  const char *target_file;
+  const DotIndex *target_index; // DOT targets
+  const HrabFile *target_hrab;  // .hrab targets
+  int target_size;
+  WorkQueue *queue;
+  int *parents; // target_size slots per target, -1 after the last parent
+  int failed;   // targets that could not be read
+} ReverseWorker;
+
+static int compare_source_keys(const void *a, const void *b) {
+  int c = memcmp(&((const SourceKey *)a)->key, &((const SourceKey *)b)->key,
+                 sizeof(HrabRecord));
+  if (c != 0)
+    return c;
+  return ((const SourceKey *)a)->source - ((const SourceKey *)b)->source;
+}
+
+static void canonical_key(const PackedGraph *pg, HrabRecord *key) {
+  int canon[MAX_NODES * MAX_NODES];
+  canonical_rep_cached(pg, canon);
+  hrab_encode(key, pg->n_nodes, canon, pg->n_nodes, 0);
+}
+
+// Lowest source index with this canonical form, or -1
+static int find_source(const SourceKey *sources, int n, const HrabRecord *key) {
+  int lo = 0, hi = n;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (memcmp(&sources[mid].key, key, sizeof(*key)) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo < n && memcmp(&sources[lo].key, key, sizeof(*key)) == 0)
+    return sources[lo].source;
+  return -1;
+}
+
+// Distinct sources reached by deleting one node of g, in ascending order.
+// The forward expansion skips sources that are not weakly connected, so
+// those deletions are not looked up.
+static int find_parents(const ReverseWorker *w, const PackedGraph *g,
+                        int *parents) {
+  int n = g->n_nodes, count = 0;
+  for (int v = 0; v < n; v++) {
+    PackedGraph sub;
+    packed_init(&sub, n - 1);
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < n; j++) {
+        int r = packed_edge(g, i, j);
+        if (i != v && j != v && r >= 0)
+          packed_add_edge(&sub, i - (i > v), j - (j > v), r);
+      }
+    if (!packed_is_weakly_connected(&sub))
+      continue;
+    HrabRecord key;
+    canonical_key(&sub, &key);
+    int s = find_source(w->sources, w->n_sources, &key);
+    if (s < 0)
+      continue;
+    int pos = count;
+    while (pos > 0 && parents[pos - 1] > s)
+      pos--;
+    if (pos > 0 && parents[pos - 1] == s)
+      continue;
+    memmove(&parents[pos + 1], &parents[pos], (count - pos) * sizeof(int));
+    parents[pos] = s;
+    count++;
+  }
+  return count;
+}
+
+static void *reverse_worker(void *arg) {
+  ReverseWorker *w = arg;
+  FILE *fp = NULL;
+  if (!w->target_hrab)
+    fp = fopen(w->target_file, "r");
+  int begin, end;
+  bool stolen;
+  while ((w->target_hrab || fp) &&
+         next_work_chunk(w->queue, w->thread_id, &begin, &end, &stolen)) {
+    for (int t = begin; t < end; t++) {
+      int *parents = &w->parents[(long long)t * w->target_size];
+      Graph g;
+      int graph_id = 0;
+      if (w->target_hrab)
+        hrab_to_graph(&w->target_hrab->records[t], &g);
+      else if (!read_dot_graph_at(fp, &w->target_index->entries[t], &g,
+                                  &graph_id)) {
+        w->failed++;
+        continue;
+      }
+      if (g.n_nodes != w->target_size) {
+        w->failed++;
+        continue;
+      }
+      PackedGraph pg;
+      graph_to_packed(&g, &pg);
+      find_parents(w, &pg, parents);
+    }
+  }
+  if (!w->target_hrab && !fp)
+    w->failed = -1;
+  if (fp)
+    fclose(fp);
+  return NULL;
+}
+
+// Per-target parent lists, in reference order
+static bool write_parent_lists(const char *output_dir, int target_size,
+                               const int *parents, int n_targets) {
+  char path[MAX_FILENAME];
+  snprintf(path, sizeof(path), "%s/reverse_n%d.csv", output_dir, target_size);
+  FILE *fp = fopen(path, "w");
+  if (!fp)
+    return false;
+  fprintf(fp, "TargetID,ParentCount,Parents\n");
+  for (int t = 0; t < n_targets; t++) {
+    const int *p = &parents[(long long)t * target_size];
+    int count = 0;
+    while (count < target_size && p[count] >= 0)
+      count++;
+    fprintf(fp, "%d,%d,", t, count);
+    for (int i = 0; i < count; i++)
+      fprintf(fp, i ? " %d" : "%d", p[i]);
+    fprintf(fp, "\n");
+  }
+  bool ok = !ferror(fp);
+  ok = fclose(fp) == 0 && ok;
+  if (ok)
+    printf("Parent lists: %s\n", path);
+  return ok;
+}
+
+int run_reverse_coverage(const HrabRecord *sources, int n_sources,
+                         int start_size, int target_size, int num_threads,
+                         const char *output_dir) {
+  char target_file[MAX_FILENAME];
+  int n_targets =
+      reference_hra_file(target_size, target_file, sizeof(target_file));
+  if (n_targets <= 0) {
+    fprintf(stderr, "Error: No reference set hras_n%d in hras_dot_files\n",
+            target_size);
+    return -1;
+  }
+  DotIndex *target_index = NULL;
+  HrabFile *target_hrab = NULL;
+  if (hrab_has_extension(target_file))
+    target_hrab = hrab_open(target_file);
+  else
+    target_index = load_dot_index(target_file);
+
+  // Sources sorted by canonical form; a repeated class keeps its first index
+  SourceKey *keys = malloc((n_sources > 0 ? n_sources : 1) *
+                           sizeof(SourceKey));
+  int *parents = malloc((long long)n_targets * target_size * sizeof(int));
+  if ((!target_index && !target_hrab) || !keys || !parents) {
+    fprintf(stderr, "Error: Cannot load %s\n", target_file);
+    free(keys);
+    free(parents);
+    free_dot_index(target_index);
+    hrab_close(target_hrab);
+    return -1;
+  }
+  int n_keys = 0;
+  for (int i = 0; i < n_sources; i++) {
+    PackedGraph pg;
+    Graph g;
+    hrab_to_graph(&sources[i], &g);
+    if (g.n_nodes != start_size)
+      continue;
+    graph_to_packed(&g, &pg);
+    canonical_key(&pg, &keys[n_keys].key);
+    keys[n_keys++].source = i;
+  }
+  qsort(keys, n_keys, sizeof(SourceKey), compare_source_keys);
+  memset(parents, -1, (long long)n_targets * target_size * sizeof(int));
+
+  pthread_t threads[MAX_THREADS];
+  ReverseWorker workers[MAX_THREADS];
+  WorkQueue queue;
+  init_work_queue(&queue, num_threads, n_targets);
+  double start = wall_time_seconds();
+  int started = 0;
+  for (int i = 0; i < num_threads; i++) {
+    workers[i].thread_id = i;
+    workers[i].sources = keys;
+    workers[i].n_sources = n_keys;
+    workers[i].target_file = target_file;
+    workers[i].target_index = target_index;
+    workers[i].target_hrab = target_hrab;
+    workers[i].target_size = target_size;
+    workers[i].queue = &queue;
+    workers[i].parents = parents;
+    workers[i].failed = 0;
+    if (pthread_create(&threads[i], NULL, reverse_worker, &workers[i]) != 0) {
+      perror("Failed to create thread");
+      // Let the started workers drain the queue
+      break;
+    }
+    started++;
+  }
+  int failed = 0;
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+    if (workers[i].failed < 0)
+      fprintf(stderr, "Thread %d: Error - cannot open %s\n", i, target_file);
+    else
+      failed += workers[i].failed;
+  }
+  double elapsed = wall_time_seconds() - start;
+  destroy_work_queue(&queue);
+
+  // Targets by number of distinct parents, and sources that are a parent
+  int covered = 0, multi = 0, singles = 0, used_sources = 0;
+  bool *is_parent = calloc(n_sources > 0 ? n_sources : 1, sizeof(bool));
+  for (int t = 0; t < n_targets; t++) {
+    const int *p = &parents[(long long)t * target_size];
+    int count = 0;
+    while (count < target_size && p[count] >= 0) {
+      if (is_parent && !is_parent[p[count]]) {
+        is_parent[p[count]] = true;
+        used_sources++;
+      }
+      count++;
+    }
+    covered += count > 0;
+    multi += count > 1;
+    singles += count == 1;
+  }
+  free(is_parent);
+
+  printf("=== Reverse Coverage Summary ===\n");
+  printf("Original: n=%d, Target: n=%d\n", start_size, target_size);
+  printf("Reference graphs checked: %d (%d unreadable)\n", n_targets, failed);
+  printf("Unique graphs from sources: %d\n", covered);
+  printf("Ratio (from/total reference hras_n%d): %.4f (%d/%d)\n", target_size,
+         (double)covered / n_targets, covered, n_targets);
+  printf("Graphs appearing from >1 sources: %d\n", multi);
+  printf("Singleton graphs (exactly 1 source): %d\n", singles);
+  printf("Sources with a child in the reference set: %d/%d\n", used_sources,
+         n_sources);
+  printf("Time: %.2f seconds\n", elapsed);
+
+  int status = started == num_threads && failed == 0 ? 0 : -1;
+  if (!write_parent_lists(output_dir, target_size, parents, n_targets)) {
+    fprintf(stderr, "Error: Failed to write the parent lists\n");
+    status = -1;
+  }
+  free(keys);
+  free(parents);
+  free_dot_index(target_index);
+  hrab_close(target_hrab);
+  return status;
+}
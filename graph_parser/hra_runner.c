@@ -6,19 +6,111 @@ pthread_mutex_t print_mutex = PTHREAD_MUTEX_INITIALIZER;
 extern void *worker_thread(void *arg);
 extern int count_graphs_in_dot_file(const char *filename);
 
+static void print_usage(const char *prog) {
+  printf("Usage: %s [--subprocess] [--binary] [--pipeline] "
+         "[--chain [--checkpoint]] [--reverse] [--cache] <dot_or_hrab_file> "
+         "[num_threads] [verbose] [start_size] [target_size]\n",
+         prog);
+  printf("  --subprocess: run ./hra_expander once per source graph instead of "
+         "expanding in-process\n");
+  printf("  --binary: write results as .hrab records instead of DOT\n");
+  printf("  --pipeline: deduplicate while expanding, without writing result "
+         "files\n");
+  printf("  --chain: expand level by level up to target_size in memory, "
+         "printing a summary per level\n");
+  printf("  --checkpoint: with --chain, write each level as "
+         "chain/chain_n<k>.hrab\n");
+  printf("  --reverse: find each reference target's parents by node deletion "
+         "instead of expanding\n");
+  printf("  --cache: reuse and extend the canonical-form cache %s\n",
+         CANON_CACHE_FILE);
+}
+
+// Keep this run's canonical forms for the next one
+static void save_cache(bool use_cache) {
+  if (!use_cache)
+    return;
+  print_canon_cache_stats();
+  if (!canon_cache_save())
+    fprintf(stderr, "Warning: Failed to save %s\n", CANON_CACHE_FILE);
+  canon_cache_close();
+}
+
+// Source graphs as records, for the chain and reverse modes
+static HrabRecord *load_chain_sources(const DotIndex *input_index,
+                                      const HrabFile *input_hrab,
+                                      const char *dot_file, int total) {
+  HrabRecord *sources = malloc(total * sizeof(HrabRecord));
+  if (!sources)
+    return NULL;
+  if (input_hrab) {
+    memcpy(sources, input_hrab->records, total * sizeof(HrabRecord));
+    return sources;
+  }
+  FILE *fp = fopen(dot_file, "r");
+  bool ok = fp != NULL;
+  for (int i = 0; ok && i < total; i++) {
+    Graph g;
+    int graph_id = 0;
+    ok = read_dot_graph_at(fp, &input_index->entries[i], &g, &graph_id);
+    if (ok)
+      graph_to_hrab(&g, i, &sources[i]);
+  }
+  if (fp)
+    fclose(fp);
+  if (!ok) {
+    free(sources);
+    return NULL;
+  }
+  return sources;
+}
+
 int main(int argc, char *argv[]) {
-  if (argc < 2) {
-    printf("Usage: %s <dot_file> [num_threads] [verbose] [start_size] "
-           "[target_size]\n",
-           argv[0]);
+  // Options may appear anywhere; everything else is positional
+  bool use_subprocess = false;
+  bool binary_output = false;
+  bool pipeline = false;
+  bool chain = false;
+  bool checkpoint = false;
+  bool reverse = false;
+  bool use_cache = false;
+  const char *pos[5];
+  int n_pos = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--subprocess") == 0) {
+      use_subprocess = true;
+    } else if (strcmp(argv[i], "--binary") == 0) {
+      binary_output = true;
+    } else if (strcmp(argv[i], "--pipeline") == 0) {
+      pipeline = true;
+    } else if (strcmp(argv[i], "--chain") == 0) {
+      chain = true;
+    } else if (strcmp(argv[i], "--checkpoint") == 0) {
+      checkpoint = true;
+    } else if (strcmp(argv[i], "--reverse") == 0) {
+      reverse = true;
+    } else if (strcmp(argv[i], "--cache") == 0) {
+      use_cache = true;
+    } else if (strncmp(argv[i], "--", 2) == 0) {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      print_usage(argv[0]);
+      return 1;
+    } else if (n_pos < 5) {
+      pos[n_pos++] = argv[i];
+    }
+  }
+  if (n_pos < 1 || (chain && use_subprocess) || (checkpoint && !chain) ||
+      (pipeline && (chain || use_subprocess || binary_output)) ||
+      (reverse && (chain || pipeline || use_subprocess || binary_output))) {
+    print_usage(argv[0]);
     return 1;
   }
 
-  const char *dot_file = argv[1];
-  int num_threads = (argc > 2) ? atoi(argv[2]) : 4;
-  bool verbose = (argc > 3) ? atoi(argv[3]) : 0;
-  int start_node_count = (argc > 4) ? atoi(argv[4]) : 3;
-  int target_node_count = (argc > 5) ? atoi(argv[5]) : 4;
+  const char *dot_file = pos[0];
+  int num_threads = (n_pos > 1) ? atoi(pos[1]) : 4;
+  bool verbose = (n_pos > 2) ? atoi(pos[2]) : 0;
+  int start_node_count = (n_pos > 3) ? atoi(pos[3]) : 3;
+  int target_node_count = (n_pos > 4) ? atoi(pos[4]) : 4;
 
   if (num_threads <= 0 || num_threads > MAX_THREADS) {
     num_threads = 4;
@@ -27,49 +119,122 @@ int main(int argc, char *argv[]) {
   printf("HRA Evolutionary Sampler\n========================\n");
   printf("Input file: %s\nThreads: %d\nVerbose: %s\n", dot_file, num_threads,
          verbose ? "Yes" : "No");
-  printf("Expanding from n=%d to n=%d\n\n", start_node_count,
+  printf("Expanding from n=%d to n=%d\n", start_node_count,
          target_node_count);
+  printf("Mode: %s\n\n", chain              ? "chain"
+                         : pipeline       ? "pipeline"
+                         : reverse        ? "reverse"
+                         : use_subprocess ? "subprocess"
+                                          : "in-process");
+  if (target_node_count <= start_node_count ||
+      (!chain && target_node_count != start_node_count + 1)) {
+    fprintf(stderr, "Error: target_size must be start_size + 1 (or larger "
+                    "with --chain)\n");
+    return 1;
+  }
 
-  int total_graphs = count_graphs_in_dot_file(dot_file);
+  // .hrab inputs are mapped; DOT inputs use the offset index, built once
+  // and cached as <dot_file>.idx (the expander reuses it too)
+  DotIndex *input_index = NULL;
+  HrabFile *input_hrab = NULL;
+  int total_graphs = 0;
+  if (hrab_has_extension(dot_file)) {
+    input_hrab = hrab_open(dot_file);
+    total_graphs = input_hrab ? (int)input_hrab->count : 0;
+  } else {
+    input_index = load_dot_index(dot_file);
+    total_graphs = input_index ? input_index->count : 0;
+  }
   if (total_graphs <= 0) {
     fprintf(stderr, "Error: No graphs found in %s\n", dot_file);
+    free_dot_index(input_index);
+    hrab_close(input_hrab);
     return 1;
   }
   printf("Found %d graphs in input file\n\n", total_graphs);
+  if (use_cache && canon_cache_open(CANON_CACHE_FILE))
+    print_canon_cache_stats();
 
   const char *output_dir = "hra_evolution_results";
-  if (mkdir(output_dir, 0755) != 0 && errno != EEXIST) {
+  if (((!chain && !pipeline) || checkpoint) && mkdir(output_dir, 0755) != 0 &&
+      errno != EEXIST) {
     perror("Failed to create output directory");
     return 1;
   }
 
+  // Chained levels stay in memory; only summaries (and checkpoints) are
+  // written. Reverse coverage needs the sources in memory too.
+  if (chain || reverse) {
+    HrabRecord *sources =
+        load_chain_sources(input_index, input_hrab, dot_file, total_graphs);
+    free_dot_index(input_index);
+    hrab_close(input_hrab);
+    if (!sources) {
+      fprintf(stderr, "Error: Cannot read the source graphs\n");
+      return 1;
+    }
+    double start = wall_time_seconds();
+    int status =
+        reverse ? run_reverse_coverage(sources, total_graphs, start_node_count,
+                                       target_node_count, num_threads,
+                                       output_dir)
+                : run_evolution_chain(sources, total_graphs, start_node_count,
+                                      target_node_count, num_threads,
+                                      output_dir, checkpoint);
+    free(sources);
+    save_cache(use_cache);
+    printf("\n%s completed in %.2f seconds\n", reverse ? "Reverse" : "Chain",
+           wall_time_seconds() - start);
+    return status == 0 ? 0 : 1;
+  }
+
   pthread_t threads[MAX_THREADS];
   WorkerThread args[MAX_THREADS];
-  int per_thread = (total_graphs + num_threads - 1) / num_threads;
-  clock_t start = clock();
+  WorkQueue queue;
+  init_work_queue(&queue, num_threads, total_graphs);
+  double start = wall_time_seconds();
 
   // Create worker threads
   for (int i = 0; i < num_threads; i++) {
     args[i].thread_id = i;
     strncpy(args[i].input_dot_file, dot_file, MAX_FILENAME - 1);
     args[i].input_dot_file[MAX_FILENAME - 1] = '\0';
-    args[i].start_graph_index = i * per_thread;
-    args[i].end_graph_index = ((i + 1) * per_thread > total_graphs)
-                                  ? total_graphs
-                                  : (i + 1) * per_thread;
+    args[i].start_graph_index = queue.ranges[i].next;
+    args[i].end_graph_index = queue.ranges[i].end;
     strncpy(args[i].output_dir, output_dir, MAX_FILENAME - 1);
     args[i].output_dir[MAX_FILENAME - 1] = '\0';
     args[i].start_node_count = start_node_count;
     args[i].target_node_count = target_node_count;
     args[i].print_mutex = &print_mutex;
     args[i].total_graphs = total_graphs;
+    args[i].input_index = input_index;
+    args[i].input_hrab = input_hrab;
+    args[i].binary_output = binary_output;
+    args[i].use_subprocess = use_subprocess;
+    args[i].use_cache = use_cache;
+    args[i].queue = &queue;
 
+    if (pipeline)
+      continue;
     if (pthread_create(&threads[i], NULL, worker_thread, &args[i]) != 0) {
       perror("Failed to create thread");
       return 1;
     }
   }
 
+  // The pipeline runs its own workers and analyzes as they go
+  if (pipeline) {
+    int status = run_pipeline(args, num_threads);
+    save_cache(use_cache);
+    destroy_work_queue(&queue);
+    free_dot_index(input_index);
+    hrab_close(input_hrab);
+    printf("\nPipeline completed in %.2f seconds\n",
+           wall_time_seconds() - start);
+    pthread_mutex_destroy(&print_mutex);
+    return status == 0 ? 0 : 1;
+  }
+
   // Wait for all threads to complete
   for (int i = 0; i < num_threads; i++) {
     if (pthread_join(threads[i], NULL) != 0) {
@@ -77,55 +242,189 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+  double elapsed = wall_time_seconds() - start;
+  destroy_work_queue(&queue);
+  free_dot_index(input_index);
+  hrab_close(input_hrab);
   printf("\nAll threads completed in %.2f seconds\n", elapsed);
   printf("Analyzing results...\n");
 
   // Pass the correct original and target sizes
   analyze_results(output_dir, start_node_count, target_node_count, dot_file,
                   verbose);
+  save_cache(use_cache);
 
   pthread_mutex_destroy(&print_mutex);
   return 0;
 }
+
+// Work queue: the initial slices match the old static split
+void init_work_queue(WorkQueue *q, int n_threads, int total) {
+  int per_thread = (total + n_threads - 1) / n_threads;
+  q->n_ranges = n_threads;
+  for (int i = 0; i < n_threads; i++) {
+    pthread_mutex_init(&q->ranges[i].lock, NULL);
+    q->ranges[i].next = (i * per_thread > total) ? total : i * per_thread;
+    q->ranges[i].end =
+        ((i + 1) * per_thread > total) ? total : (i + 1) * per_thread;
+  }
+}
+
+void destroy_work_queue(WorkQueue *q) {
+  for (int i = 0; i < q->n_ranges; i++)
+    pthread_mutex_destroy(&q->ranges[i].lock);
+}
+
+// Claim up to WORK_CHUNK indices from the front of r
+static bool take_chunk(WorkRange *r, int *begin, int *end) {
+  pthread_mutex_lock(&r->lock);
+  bool ok = r->next < r->end;
+  if (ok) {
+    *begin = r->next;
+    *end = (r->end - r->next > WORK_CHUNK) ? r->next + WORK_CHUNK : r->end;
+    r->next = *end;
+  }
+  pthread_mutex_unlock(&r->lock);
+  return ok;
+}
+
+// Next chunk for thread self: from its own slice, else stolen from the
+// back of the busiest one. Only one lock is held at a time. Returns false
+// once every slice is empty.
+bool next_work_chunk(WorkQueue *q, int self, int *begin, int *end,
+                     bool *stolen) {
+  WorkRange *own = &q->ranges[self];
+  *stolen = false;
+  while (!take_chunk(own, begin, end)) {
+    // Pick a victim; the steal rechecks its slice under the lock
+    int victim = -1, most = 0;
+    for (int i = 0; i < q->n_ranges; i++) {
+      if (i == self)
+        continue;
+      pthread_mutex_lock(&q->ranges[i].lock);
+      int left = q->ranges[i].end - q->ranges[i].next;
+      pthread_mutex_unlock(&q->ranges[i].lock);
+      if (left > most) {
+        most = left;
+        victim = i;
+      }
+    }
+    if (victim < 0)
+      return false;
+
+    WorkRange *v = &q->ranges[victim];
+    int steal_begin = 0, steal_end = 0;
+    pthread_mutex_lock(&v->lock);
+    int left = v->end - v->next;
+    if (left > 0) {
+      // Leave the victim the front half, which it is working towards
+      steal_end = v->end;
+      steal_begin = v->end - (left + 1) / 2;
+      v->end = steal_begin;
+    }
+    pthread_mutex_unlock(&v->lock);
+    if (steal_begin == steal_end)
+      continue;
+
+    pthread_mutex_lock(&own->lock);
+    own->next = steal_begin;
+    own->end = steal_end;
+    pthread_mutex_unlock(&own->lock);
+    *stolen = true;
+  }
+  return true;
+}
+
+// Expand one source graph, in-process or through ./hra_expander
+static bool expand_source_graph(WorkerThread *worker, FILE *input_fp,
+                                int graph_idx) {
+  char thread_output_file[MAX_FILENAME];
+  snprintf(thread_output_file, MAX_FILENAME, "%s/thread_%d_graph_%d.%s",
+           worker->output_dir, worker->thread_id, graph_idx,
+           worker->binary_output ? "hrab" : "dot");
+
+  if (!worker->use_subprocess) {
+    Graph base;
+    int graph_id = 0;
+    bool loaded = true;
+    if (worker->input_hrab)
+      hrab_to_graph(&worker->input_hrab->records[graph_idx], &base);
+    else
+      loaded = read_dot_graph_at(input_fp,
+                                 &worker->input_index->entries[graph_idx],
+                                 &base, &graph_id);
+    if (loaded &&
+        expand_graph_to_file(&base, graph_idx, worker->start_node_count,
+                             worker->target_node_count,
+                             thread_output_file) >= 0)
+      return true;
+    pthread_mutex_lock(worker->print_mutex);
+    fprintf(stderr, "Thread %d: Warning - expansion failed for graph %d\n",
+            worker->thread_id, graph_idx);
+    pthread_mutex_unlock(worker->print_mutex);
+    return false;
+  }
+
+  char cmd[1024];
+  snprintf(cmd, sizeof(cmd), "./hra_expander \"%s\" %d \"%s\" %d %d%s",
+           worker->input_dot_file, graph_idx, thread_output_file,
+           worker->start_node_count, worker->target_node_count,
+           worker->use_cache ? " --cache" : "");
+
+  int result = system(cmd);
+  if (result == 0)
+    return true;
+  pthread_mutex_lock(worker->print_mutex);
+  fprintf(stderr,
+          "Thread %d: Warning - subprocess failed for graph %d (cmd: %s)\n",
+          worker->thread_id, graph_idx, cmd);
+  pthread_mutex_unlock(worker->print_mutex);
+  return false;
+}
+
 // Worker thread function
 void *worker_thread(void *arg) {
   WorkerThread *worker = (WorkerThread *)arg;
 
   pthread_mutex_lock(worker->print_mutex);
-  printf("Thread %d: Processing graphs %d to %d\n", worker->thread_id,
+  printf("Thread %d: Starting on graphs %d to %d\n", worker->thread_id,
          worker->start_graph_index, worker->end_graph_index - 1);
   pthread_mutex_unlock(worker->print_mutex);
 
   int graphs_processed = 0;
+  int steals = 0;
 
-  for (int graph_idx = worker->start_graph_index;
-       graph_idx < worker->end_graph_index; graph_idx++) {
-
-    char thread_output_file[MAX_FILENAME];
-    snprintf(thread_output_file, MAX_FILENAME, "%s/thread_%d_graph_%d.dot",
-             worker->output_dir, worker->thread_id, graph_idx);
-
-    char cmd[1024];
-    snprintf(cmd, sizeof(cmd), "./hra_expander \"%s\" %d \"%s\" %d %d",
-             worker->input_dot_file, graph_idx, thread_output_file,
-             worker->start_node_count, worker->target_node_count);
-
-    int result = system(cmd);
-    if (result == 0) {
-      graphs_processed++;
-    } else {
+  // In-process workers seek straight to each source graph
+  FILE *input_fp = NULL;
+  if (!worker->use_subprocess && !worker->input_hrab) {
+    input_fp = fopen(worker->input_dot_file, "r");
+    if (!input_fp) {
       pthread_mutex_lock(worker->print_mutex);
-      fprintf(stderr,
-              "Thread %d: Warning - subprocess failed for graph %d (cmd: %s)\n",
-              worker->thread_id, graph_idx, cmd);
+      fprintf(stderr, "Thread %d: Error - cannot open %s\n",
+              worker->thread_id, worker->input_dot_file);
       pthread_mutex_unlock(worker->print_mutex);
+      return NULL;
     }
   }
 
+  // Chunks come from this thread's slice first, then from other threads'
+  int chunk_begin, chunk_end;
+  bool stolen;
+  while (next_work_chunk(worker->queue, worker->thread_id, &chunk_begin,
+                         &chunk_end, &stolen)) {
+    if (stolen)
+      steals++;
+    for (int graph_idx = chunk_begin; graph_idx < chunk_end; graph_idx++)
+      if (expand_source_graph(worker, input_fp, graph_idx))
+        graphs_processed++;
+  }
+
+  if (input_fp)
+    fclose(input_fp);
+
   pthread_mutex_lock(worker->print_mutex);
-  printf("Thread %d completed: processed %d graphs\n", worker->thread_id,
-         graphs_processed);
+  printf("Thread %d completed: processed %d graphs (%d steals)\n",
+         worker->thread_id, graphs_processed, steals);
   pthread_mutex_unlock(worker->print_mutex);
 
   return NULL;
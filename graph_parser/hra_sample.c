@@ -0,0 +1,116 @@
+// Random sampling of graphs.
+//
+// randomly_sample_graph draws uniformly from a reference file (DOT through
+// its offset index, or .hrab), and since a reference set holds one graph
+// per isomorphism class that is uniform up to isomorphism. For sizes with
+// no reference set, sample_labelled_graph draws a graph uniformly over all
+// labelled graphs on n nodes; hra_estimate reweights those draws by their
+// automorphism counts to get uniform-over-classes estimates.
+#include "hra_sampler.h"
+
+void sample_rng_seed(SampleRng *rng, unsigned long long seed) {
+  // splitmix64 step, so nearby seeds give unrelated streams; never zero
+  seed += 0x9E3779B97F4A7C15ULL;
+  seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+  seed ^= seed >> 31;
+  rng->state = seed ? seed : 1;
+}
+
+// xorshift64*
+unsigned long long sample_rng_next(SampleRng *rng) {
+  rng->state ^= rng->state >> 12;
+  rng->state ^= rng->state << 25;
+  rng->state ^= rng->state >> 27;
+  return rng->state * 0x2545F4914F6CDD1DULL;
+}
+
+// Uniform in [0, bound) by rejecting the biased top of the range
+unsigned long long sample_rng_below(SampleRng *rng, unsigned long long bound) {
+  unsigned long long limit = ~0ULL - (~0ULL % bound);
+  unsigned long long r;
+  do {
+    r = sample_rng_next(rng);
+  } while (r >= limit);
+  return r % bound;
+}
+
+// Every ordered pair of distinct nodes gets one of states states: no edge,
+// gray, and (with 3 states) black
+void sample_labelled_graph(SampleRng *rng, int n, int states, Graph *g) {
+  init_graph(g, n);
+  // Draw states^k at once while it fits in 32 bits
+  int per_draw = states == 2 ? 32 : 20;
+  unsigned long long bits = 0;
+  int left = 0;
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++) {
+      if (i == j)
+        continue;
+      if (left == 0) {
+        bits = states == 2 ? sample_rng_next(rng) >> 32
+                           : sample_rng_below(rng, 3486784401ULL); // 3^20
+        left = per_draw;
+      }
+      int s = (int)(bits % (unsigned int)states);
+      bits /= (unsigned int)states;
+      left--;
+      if (s > 0)
+        add_edge(g, i, j, s - 1);
+    }
+}
+
+static SampleRng g_sample_rng;
+static bool g_sample_rng_seeded = false;
+
+void seed_graph_sampler(unsigned long long seed) {
+  sample_rng_seed(&g_sample_rng, seed);
+  g_sample_rng_seeded = true;
+}
+
+// One graph drawn uniformly from filename (DOT or .hrab). total_graphs is
+// the file's graph count, or <= 0 to look it up. graph_id is set to the
+// graph's position in the file. Returns NULL on error; free the result.
+// Uses one process-wide stream (seed_graph_sampler), so not thread-safe.
+SampledGraph *randomly_sample_graph(const char *filename, int total_graphs) {
+  if (!g_sample_rng_seeded)
+    seed_graph_sampler((unsigned long long)time(NULL) ^
+                       ((unsigned long long)getpid() << 32));
+  bool binary = hrab_has_extension(filename);
+  if (total_graphs <= 0)
+    total_graphs = binary ? (int)hrab_count(filename)
+                          : dot_index_count(filename);
+  if (total_graphs <= 0)
+    return NULL;
+
+  SampledGraph *sg = malloc(sizeof(SampledGraph));
+  if (!sg)
+    return NULL;
+  snprintf(sg->filename, sizeof(sg->filename), "%s", filename);
+  sg->graph_id =
+      (int)sample_rng_below(&g_sample_rng, (unsigned long long)total_graphs);
+
+  bool ok = false;
+  if (binary) {
+    HrabFile *hf = hrab_open(filename);
+    if (hf && sg->graph_id < hf->count) {
+      hrab_to_graph(&hf->records[sg->graph_id], &sg->graph);
+      ok = true;
+    }
+    hrab_close(hf);
+  } else {
+    DotIndexEntry entry;
+    FILE *fp = NULL;
+    int parsed_id = 0;
+    ok = dot_index_entry(filename, sg->graph_id, &entry) &&
+         (fp = fopen(filename, "r")) != NULL &&
+         read_dot_graph_at(fp, &entry, &sg->graph, &parsed_id);
+    if (fp)
+      fclose(fp);
+  }
+  if (!ok) {
+    free(sg);
+    return NULL;
+  }
+  return sg;
+}
@@ -1,11 +1,24 @@
 
 #include "hra_sampler.h"
 
-static int g_last_source_id = -1;
 
 // Forward decls specific to this file
 static int count_reference_graphs(const char *path);
 
+static bool has_suffix(const char *name, const char *suffix) {
+  size_t n = strlen(name), m = strlen(suffix);
+  return n >= m && strcmp(name + n - m, suffix) == 0;
+}
+
+static void record_expanded_graph(UniqueGraphSet *all_unique,
+                                  UniqueGraphSet *from_sources, const Graph *g,
+                                  const char *source_tag) {
+  char canonical_rep[MAX_NODES * MAX_NODES * sizeof(int)];
+  compute_canonical_representation(g, canonical_rep);
+  add_unique_graph(all_unique, canonical_rep, source_tag);
+  add_unique_graph(from_sources, canonical_rep, source_tag);
+}
+
 int analyze_results(const char *results_dir, int original_size, int target_size,
                     const char *source_dot_file, bool verbose) {
   printf("Analyzing results in %s...\n", results_dir);
@@ -19,26 +32,42 @@ int analyze_results(const char *results_dir, int original_size, int target_size,
   int files_processed = 0;
 
   while ((entry = readdir(dir)) != NULL) {
-    if (!strstr(entry->d_name, ".dot"))
+    bool binary = has_suffix(entry->d_name, ".hrab");
+    if (!binary && !has_suffix(entry->d_name, ".dot"))
       continue;
     char path[MAX_FILENAME];
     snprintf(path, MAX_FILENAME, "%s/%s", results_dir, entry->d_name);
     if (verbose)
       printf(" Processing %s...\n", path);
 
+    if (binary) {
+      // Records carry their own source id
+      HrabFile *hf = hrab_open(path);
+      if (!hf)
+        continue;
+      for (long long i = 0; i < hf->count; i++) {
+        Graph g;
+        hrab_to_graph(&hf->records[i], &g);
+        char source_tag[64];
+        snprintf(source_tag, sizeof(source_tag), "Source:%d",
+                 hrab_source(&hf->records[i]));
+        record_expanded_graph(all_unique, from_sources, &g, source_tag);
+      }
+      hrab_close(hf);
+      files_processed++;
+      continue;
+    }
+
     FILE *fp = fopen(path, "r");
     if (!fp)
       continue;
 
     Graph g;
-    int graph_id = -1;
-    while (parse_single_dot_graph(fp, &g, &graph_id)) {
-      char canonical_rep[MAX_NODES * MAX_NODES * sizeof(int)];
-      compute_canonical_representation(&g, canonical_rep);
-
+    int graph_id = -1, source_id = -1;
+    while (parse_single_dot_graph(fp, &g, &graph_id, &source_id)) {
       char source_tag[64];
-      if (g_last_source_id >= 0) {
-        snprintf(source_tag, sizeof(source_tag), "Source:%d", g_last_source_id);
+      if (source_id >= 0) {
+        snprintf(source_tag, sizeof(source_tag), "Source:%d", source_id);
       } else {
         // Fallback: take an id from filename
         int fid = 0;
@@ -46,8 +75,7 @@ int analyze_results(const char *results_dir, int original_size, int target_size,
         snprintf(source_tag, sizeof(source_tag), "File:%03d", fid);
       }
 
-      add_unique_graph(all_unique, canonical_rep, source_tag);
-      add_unique_graph(from_sources, canonical_rep, source_tag);
+      record_expanded_graph(all_unique, from_sources, &g, source_tag);
     }
     fclose(fp);
     files_processed++;
@@ -55,14 +83,41 @@ int analyze_results(const char *results_dir, int original_size, int target_size,
   closedir(dir);
 
   printf("Processed %d result files\n", files_processed);
+  report_analysis(all_unique, from_sources, original_size, target_size);
 
-  // Determine denominator by parsing reference canonical set if present
-  char ref_path[MAX_FILENAME];
-  snprintf(ref_path, sizeof(ref_path), "hras_dot_files/hras_n%d.dot", target_size);
-  int total_target = count_reference_graphs(ref_path);
+  free_unique_graph_set(all_unique);
+  free_unique_graph_set(from_sources);
+  return 0;
+}
+
+// Summary plus hra_stats.csv, shared by analyze_results and the pipeline
+void report_analysis(const UniqueGraphSet *all_unique,
+                     const UniqueGraphSet *from_sources, int original_size,
+                     int target_size) {
+  // Determine denominator from the reference canonical set if present
+  int total_target = reference_hra_count(target_size);
   print_analysis_summary(all_unique, from_sources, total_target, original_size,
                          target_size);
 
+  // The ratio above only counts classes; check them against the reference's
+  // canonical index, built on first use
+  char ref_path[MAX_FILENAME];
+  CanonIndex *ci = NULL;
+  if (reference_hra_file(target_size, ref_path, sizeof(ref_path)) > 0)
+    ci = load_canon_index(ref_path);
+  if (ci) {
+    int covered = 0;
+    for (int i = 0; i < all_unique->count; i++) {
+      HrabRecord key;
+      hrab_encode(&key, target_size,
+                  (const int *)all_unique->unique_graphs[i].canonical_rep,
+                  target_size, 0);
+      covered += canon_index_find(ci, &key) >= 0;
+    }
+    print_reference_coverage(ci, target_size, covered, all_unique->count);
+    free_canon_index(ci);
+  }
+
   // Dump frequency CSV
   FILE *csv = fopen("hra_stats.csv", "w");
   if (csv) {
@@ -72,10 +127,6 @@ int analyze_results(const char *results_dir, int original_size, int target_size,
     }
     fclose(csv);
   }
-
-  free_unique_graph_set(all_unique);
-  free_unique_graph_set(from_sources);
-  return 0;
 }
 
 // Graph set management functions
@@ -114,10 +165,43 @@ bool add_graph_to_set(GraphSet *gs, const SampledGraph *sg) {
 }
 
 // Unique graph set
+#define CANONICAL_REP_BYTES (MAX_NODES * MAX_NODES * sizeof(int))
+
+// FNV-1a over the full canonical buffer (unused tail bytes are zero)
+unsigned long long hash_canonical_rep(const char *canonical_rep) {
+  unsigned long long h = 1469598103934665603ULL;
+  for (size_t i = 0; i < CANONICAL_REP_BYTES; i++) {
+    h ^= (unsigned char)canonical_rep[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static bool rehash_unique_graph_set(UniqueGraphSet *ugs, int slot_capacity) {
+  int *slots = malloc(slot_capacity * sizeof(int));
+  if (!slots)
+    return false;
+  for (int i = 0; i < slot_capacity; i++)
+    slots[i] = -1;
+  unsigned long long mask = (unsigned long long)slot_capacity - 1;
+  for (int i = 0; i < ugs->count; i++) {
+    unsigned long long s = ugs->unique_graphs[i].hash & mask;
+    while (slots[s] != -1)
+      s = (s + 1) & mask;
+    slots[s] = i;
+  }
+  free(ugs->slots);
+  ugs->slots = slots;
+  ugs->slot_capacity = slot_capacity;
+  return true;
+}
+
 UniqueGraphSet *create_unique_graph_set(int initial_capacity) {
   UniqueGraphSet *ugs = malloc(sizeof(UniqueGraphSet));
   if (!ugs)
     return NULL;
+  if (initial_capacity < 1)
+    initial_capacity = 1;
   ugs->unique_graphs = malloc(initial_capacity * sizeof(UniqueGraph));
   if (!ugs->unique_graphs) {
     free(ugs);
@@ -125,6 +209,16 @@ UniqueGraphSet *create_unique_graph_set(int initial_capacity) {
   }
   ugs->count = 0;
   ugs->capacity = initial_capacity;
+  ugs->slots = NULL;
+  ugs->slot_capacity = 0;
+  int slot_capacity = 16;
+  while (slot_capacity < 2 * initial_capacity)
+    slot_capacity *= 2;
+  if (!rehash_unique_graph_set(ugs, slot_capacity)) {
+    free(ugs->unique_graphs);
+    free(ugs);
+    return NULL;
+  }
   return ugs;
 }
 
@@ -138,33 +232,55 @@ void free_unique_graph_set(UniqueGraphSet *ugs) {
     free(ugs->unique_graphs[i].source_graphs);
   }
   free(ugs->unique_graphs);
+  free(ugs->slots);
   free(ugs);
 }
 
+// Slot holding canonical_rep, or the empty slot where it would go
+static int probe_unique_graph(const UniqueGraphSet *ugs,
+                              const char *canonical_rep,
+                              unsigned long long hash) {
+  unsigned long long mask = (unsigned long long)ugs->slot_capacity - 1;
+  unsigned long long s = hash & mask;
+  while (ugs->slots[s] != -1) {
+    const UniqueGraph *ug = &ugs->unique_graphs[ugs->slots[s]];
+    if (ug->hash == hash &&
+        memcmp(ug->canonical_rep, canonical_rep, CANONICAL_REP_BYTES) == 0)
+      break;
+    s = (s + 1) & mask;
+  }
+  return (int)s;
+}
+
+int find_unique_graph(const UniqueGraphSet *ugs, const char *canonical_rep) {
+  int s = probe_unique_graph(ugs, canonical_rep,
+                             hash_canonical_rep(canonical_rep));
+  return ugs->slots[s];
+}
+
 bool add_unique_graph(UniqueGraphSet *ugs, const char *canonical_rep,
                       const char *source_graph) {
-  for (int i = 0; i < ugs->count; i++) {
-    if (memcmp(ugs->unique_graphs[i].canonical_rep, canonical_rep,
-               MAX_NODES * MAX_NODES * sizeof(int)) == 0) {
-      UniqueGraph *ug = &ugs->unique_graphs[i];
-      // Check for duplicate source tag
-      for (int s = 0; s < ug->source_count; s++) {
-        if (strcmp(ug->source_graphs[s], source_graph) == 0) {
-          return true; // already recorded
-        }
+  unsigned long long hash = hash_canonical_rep(canonical_rep);
+  int slot = probe_unique_graph(ugs, canonical_rep, hash);
+  if (ugs->slots[slot] != -1) {
+    UniqueGraph *ug = &ugs->unique_graphs[ugs->slots[slot]];
+    // Check for duplicate source tag
+    for (int s = 0; s < ug->source_count; s++) {
+      if (strcmp(ug->source_graphs[s], source_graph) == 0) {
+        return true; // already recorded
       }
-      if (ug->source_count >= ug->source_capacity) {
-        int nc = ug->source_capacity * 2;
-        char **tmp = realloc(ug->source_graphs, nc * sizeof(char *));
-        if (!tmp)
-          return false;
-        ug->source_graphs = tmp;
-        ug->source_capacity = nc;
-      }
-      ug->source_graphs[ug->source_count] = strdup(source_graph);
-      ug->source_count++;
-      return true;
     }
+    if (ug->source_count >= ug->source_capacity) {
+      int nc = ug->source_capacity * 2;
+      char **tmp = realloc(ug->source_graphs, nc * sizeof(char *));
+      if (!tmp)
+        return false;
+      ug->source_graphs = tmp;
+      ug->source_capacity = nc;
+    }
+    ug->source_graphs[ug->source_count] = strdup(source_graph);
+    ug->source_count++;
+    return true;
   }
   if (ugs->count >= ugs->capacity) {
     int nc = ugs->capacity * 2;
@@ -174,31 +290,36 @@ bool add_unique_graph(UniqueGraphSet *ugs, const char *canonical_rep,
     ugs->unique_graphs = tmp;
     ugs->capacity = nc;
   }
+  // Keep the load factor at or below one half
+  if (2 * (ugs->count + 1) > ugs->slot_capacity) {
+    if (!rehash_unique_graph_set(ugs, ugs->slot_capacity * 2))
+      return false;
+    slot = probe_unique_graph(ugs, canonical_rep, hash);
+  }
   UniqueGraph *ng = &ugs->unique_graphs[ugs->count];
-  memcpy(ng->canonical_rep, canonical_rep, MAX_NODES * MAX_NODES * sizeof(int));
+  memcpy(ng->canonical_rep, canonical_rep, CANONICAL_REP_BYTES);
+  ng->hash = hash;
   ng->source_capacity = 4;
   ng->source_graphs = malloc(ng->source_capacity * sizeof(char *));
+  if (!ng->source_graphs)
+    return false;
   ng->source_graphs[0] = strdup(source_graph);
   ng->source_count = 1;
+  ugs->slots[slot] = ugs->count;
   ugs->count++;
   return true;
 }
 
 // DOT parsing
 int count_graphs_in_dot_file(const char *filename) {
-  FILE *fp = fopen(filename, "r");
-  if (!fp)
-    return -1;
-  char line[MAX_LINE];
-  int c = 0;
-  while (fgets(line, sizeof(line), fp))
-    if (strstr(line, "digraph"))
-      c++;
-  fclose(fp);
-  return c;
+  // O(1) once the offset index exists
+  return dot_index_count(filename);
 }
 
-bool parse_single_dot_graph(FILE *fp, Graph *g, int *graph_id) {
+// graph_id and source_id (if not NULL) keep their values unless the graph
+// sets them; source_id comes from a "// Source:<id>" comment before it
+bool parse_single_dot_graph(FILE *fp, Graph *g, int *graph_id,
+                            int *source_id) {
   char line[MAX_LINE];
   bool in_graph = false;
   int max_node_id = -1; // Track the highest node ID seen
@@ -208,8 +329,8 @@ bool parse_single_dot_graph(FILE *fp, Graph *g, int *graph_id) {
     // Track provenance comments preceding a graph block
     if (!in_graph && strncmp(line, "// Source:", 10) == 0) {
       int sid = -1;
-      if (sscanf(line, "// Source:%d", &sid) == 1) {
-        g_last_source_id = sid;
+      if (sscanf(line, "// Source:%d", &sid) == 1 && source_id) {
+        *source_id = sid;
       }
       continue;
     }
@@ -239,6 +360,34 @@ bool parse_single_dot_graph(FILE *fp, Graph *g, int *graph_id) {
   }
   return false;
 }
+
+// .hrab conversion; edges come back in row-major order
+void graph_to_hrab(const Graph *g, int source_id, HrabRecord *rec) {
+  hrab_encode(rec, g->n_nodes, &g->adj_matrix[0][0], MAX_NODES, source_id);
+}
+
+void hrab_to_graph(const HrabRecord *rec, Graph *g) {
+  int n = hrab_node_count(rec);
+  init_graph(g, n);
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++) {
+      int r = hrab_edge(rec, i, j);
+      if (r >= 0)
+        add_edge(g, i, j, r);
+    }
+}
+
+void graph_to_packed(const Graph *g, PackedGraph *pg) {
+  packed_from_adjacency(pg, g->n_nodes, &g->adj_matrix[0][0], MAX_NODES);
+}
+
+// Monotonic wall-clock time; clock() would sum CPU time across threads
+double wall_time_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 // Graph utilities
 void init_graph(Graph *g, int n) {
   g->n_nodes = n;
@@ -333,33 +482,14 @@ bool next_permutation(int *arr, int n) {
   return true;
 }
 
-// Lexicographically minimal adjacency under all node label permutations (n<=6)
+// Canonicalization runs on the packed form (hra_packed.c)
 void compute_canonical_representation(const Graph *g, char *canonical_rep) {
-  int n = g->n_nodes;
   memset(canonical_rep, 0, MAX_NODES * MAX_NODES * sizeof(int));
-  int best[MAX_NODES * MAX_NODES];
-  bool has_best = false;
-  int perm[MAX_NODES];
-  for (int i = 0; i < n; i++)
-    perm[i] = i;
-  if (n <= 6) {
-    do {
-      int cur[MAX_NODES * MAX_NODES];
-      for (int i = 0; i < n; i++)
-        for (int j = 0; j < n; j++)
-          cur[i * n + j] = g->adj_matrix[perm[i]][perm[j]];
-      if (!has_best || memcmp(cur, best, n * n * sizeof(int)) < 0) {
-        memcpy(best, cur, n * n * sizeof(int));
-        has_best = true;
-      }
-    } while (next_permutation(perm, n));
-    memcpy(canonical_rep, best, n * n * sizeof(int));
-  } else {
-    // Fallback: direct adjacency
-    for (int i = 0; i < n; i++)
-      for (int j = 0; j < n; j++)
-        ((int *)canonical_rep)[i * n + j] = g->adj_matrix[i][j];
-  }
+  if (g->n_nodes <= 0 || g->n_nodes > MAX_NODES)
+    return;
+  PackedGraph pg;
+  graph_to_packed(g, &pg);
+  canonical_rep_cached(&pg, (int *)canonical_rep);
 }
 
 void print_analysis_summary(const UniqueGraphSet *all_unique,
@@ -385,16 +515,27 @@ void print_analysis_summary(const UniqueGraphSet *all_unique,
   printf("Singleton graphs (exactly 1 source): %d\n", singles);
 }
 
-// Count digraphs in a reference file for ratio denominator
+// Count graphs in a reference file for ratio denominator
 static int count_reference_graphs(const char *path) {
-  FILE *fp = fopen(path, "r");
-  if (!fp)
-    return -1;
-  char line[MAX_LINE];
-  int c = 0;
-  while (fgets(line, sizeof(line), fp))
-    if (strstr(line, "digraph"))
-      c++;
-  fclose(fp);
-  return c;
+  if (hrab_has_extension(path))
+    return (int)hrab_count(path);
+  return dot_index_count(path);
+}
+
+// Reference set for n nodes, preferring the binary form: fills path and
+// returns its graph count, or -1 if there is none
+int reference_hra_file(int n, char *path, size_t size) {
+  snprintf(path, size, "hras_dot_files/hras_n%d.hrab", n);
+  int count = count_reference_graphs(path);
+  if (count < 0) {
+    snprintf(path, size, "hras_dot_files/hras_n%d.dot", n);
+    count = count_reference_graphs(path);
+  }
+  return count;
+}
+
+// Size of the reference set for n nodes; -1 if there is none
+int reference_hra_count(int n) {
+  char ref_path[MAX_FILENAME];
+  return reference_hra_file(n, ref_path, sizeof(ref_path));
 }
@@ -15,6 +15,10 @@
 #include <time.h>
 #include <unistd.h>
 #include <limits.h>
+#include <stddef.h>
+
+#include "hra_binary.h"
+#include "hra_packed.h"
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
@@ -27,6 +31,13 @@
 #define MAX_LINE 2048
 #define MAX_THREADS 16
 
+#if MAX_NODES > HRAB_MAX_NODES
+#error "MAX_NODES does not fit the .hrab record layout"
+#endif
+#if MAX_NODES > PACKED_MAX_NODES
+#error "MAX_NODES does not fit PackedGraph"
+#endif
+
 // Graph structures (reusing from your original code)
 typedef struct {
   int from;
@@ -56,6 +67,57 @@ typedef struct {
   int capacity;
 } GraphSet;
 
+// Random number stream for sampling (xorshift64*, see hra_sample.c)
+typedef struct {
+  unsigned long long state;
+} SampleRng;
+
+// One digraph block of a DOT file (see hra_index.c)
+typedef struct {
+  long long offset; // byte offset of the "digraph" line
+  int n_nodes;
+  int n_edges;
+} DotIndexEntry;
+
+typedef struct {
+  DotIndexEntry *entries;
+  int count;
+} DotIndex;
+
+// Keys are compared and hashed on the bytes before the source field
+#define CANON_KEY_BYTES offsetof(HrabRecord, source)
+
+// Canonical keys with a hash slot table over them (hra_keytable.c). A table
+// can also be a view into a mapped file, which key_table_free must not see.
+typedef struct {
+  HrabRecord *keys;
+  int count;
+  int capacity;      // allocated keys
+  int *slots;        // -1 marks an empty slot
+  int slot_capacity; // power of two, at least twice count
+} KeyTable;
+
+// Canonical keys of a reference set (hra_refindex.c); each key's source
+// field is its position in the file
+typedef KeyTable CanonIndex;
+
+// Dynamic scheduling for the runner's workers. Each thread starts with a
+// contiguous slice of source indices and takes it WORK_CHUNK at a time; a
+// thread whose slice is empty steals the back half of the largest
+// remaining slice.
+#define WORK_CHUNK 4
+
+typedef struct {
+  pthread_mutex_t lock;
+  int next; // next unclaimed source index
+  int end;  // one past the last index in this slice
+} WorkRange;
+
+typedef struct {
+  WorkRange ranges[MAX_THREADS];
+  int n_ranges;
+} WorkQueue;
+
 typedef struct {
   int thread_id;
   SampledGraph *input_graph;
@@ -66,22 +128,40 @@ typedef struct {
   int start_graph_index;
   int end_graph_index;
   int total_graphs;
+  const DotIndex *input_index; // offsets of the source graphs (DOT input)
+  const HrabFile *input_hrab;  // mapped source graphs (.hrab input)
+  bool binary_output;          // write thread_*_graph_*.hrab results
+  bool use_subprocess;       // run ./hra_expander per graph for isolation
+  bool use_cache;            // subprocesses read CANON_CACHE_FILE too
+  WorkQueue *queue;          // shared source index dispenser
   pthread_mutex_t *print_mutex;
 } WorkerThread;
 
 typedef struct {
   char canonical_rep[MAX_NODES * MAX_NODES * sizeof(int)];
+  unsigned long long hash;
   int source_count;
   char **source_graphs;
   int source_capacity;
 } UniqueGraph;
 
+// Unique graphs are kept in insertion order; slots is an open-addressing
+// (linear probing) index into unique_graphs keyed by the canonical hash.
 typedef struct {
   UniqueGraph *unique_graphs;
   int count;
   int capacity;
+  int *slots; // -1 marks an empty slot
+  int slot_capacity; // power of two, at least twice count
 } UniqueGraphSet;
 
+// Receives each accepted child of expand_single_graph
+typedef struct ExpandSink {
+  void (*emit)(struct ExpandSink *sink, const Graph *child,
+               const char *canonical_rep, int source_id, int child_index);
+  void *ctx;
+} ExpandSink;
+
 // Function declarations
 GraphSet *create_graph_set(int initial_capacity);
 void free_graph_set(GraphSet *gs);
@@ -91,15 +171,87 @@ UniqueGraphSet *create_unique_graph_set(int initial_capacity);
 void free_unique_graph_set(UniqueGraphSet *ugs);
 bool add_unique_graph(UniqueGraphSet *ugs, const char *canonical_rep,
                       const char *source_graph);
+int find_unique_graph(const UniqueGraphSet *ugs, const char *canonical_rep);
+unsigned long long hash_canonical_rep(const char *canonical_rep);
 
 int parse_dot_file(const char *filename, GraphSet *graph_set);
-bool parse_single_dot_graph(FILE *fp, Graph *g, int *graph_id);
+bool parse_single_dot_graph(FILE *fp, Graph *g, int *graph_id,
+                            int *source_id);
 void print_graph(const Graph *g);
 
 int count_graphs_in_dot_file(const char *filename);
+
+// DOT offset index (hra_index.c), cached next to the file as <file>.idx
+DotIndex *load_dot_index(const char *dot_file);
+void free_dot_index(DotIndex *idx);
+int dot_index_count(const char *dot_file);
+bool dot_index_entry(const char *dot_file, int graph_index,
+                     DotIndexEntry *entry);
+bool read_dot_graph_at(FILE *fp, const DotIndexEntry *entry, Graph *g,
+                       int *graph_id);
+
+// Canonical key tables (hra_keytable.c). key_table_init allocates room for
+// capacity keys with slots to match; key_table_add grows as needed.
+unsigned long long canon_key_hash(const HrabRecord *key);
+int key_table_slot_capacity(int count);
+bool key_table_init(KeyTable *t, int capacity);
+int key_table_probe(const KeyTable *t, const HrabRecord *key); // slot
+int key_table_find(const KeyTable *t, const HrabRecord *key);  // -1 if absent
+bool key_table_rehash(KeyTable *t, int slot_capacity);
+bool key_table_add(KeyTable *t, const HrabRecord *key); // key not present
+bool key_table_valid(const KeyTable *t);
+void key_table_free(KeyTable *t);
+
+// Canonical index of a reference file (hra_refindex.c), cached next to it
+// as <file>.canon
+CanonIndex *load_canon_index(const char *ref_file);
+void free_canon_index(CanonIndex *ci);
+int canon_index_find(const CanonIndex *ci, const HrabRecord *key);
+void print_reference_coverage(const CanonIndex *ci, int n, int covered,
+                              int found);
+
+// Persistent canonical-form cache (hra_canon_cache.c). Once opened, every
+// canonicalization in the process goes through it; canonical_rep_cached
+// returns the class id, or -1 with no cache.
+#define CANON_CACHE_FILE "canon_cache.hrcc" // --cache, in the run directory
+bool canon_cache_open(const char *path);
+bool canon_cache_save(void);
+void canon_cache_close(void);
+int canonical_rep_cached(const PackedGraph *pg, int *canon);
+void print_canon_cache_stats(void);
+
+// .hrab conversion (hra_binary.h has the file format)
+void graph_to_hrab(const Graph *g, int source_id, HrabRecord *rec);
+void hrab_to_graph(const HrabRecord *rec, Graph *g);
+
+// Packed form for the hot loops (hra_packed.h)
+void graph_to_packed(const Graph *g, PackedGraph *pg);
+
+// Random sampling (hra_sample.c)
+void sample_rng_seed(SampleRng *rng, unsigned long long seed);
+unsigned long long sample_rng_next(SampleRng *rng);
+unsigned long long sample_rng_below(SampleRng *rng, unsigned long long bound);
+void sample_labelled_graph(SampleRng *rng, int n, int states, Graph *g);
+void seed_graph_sampler(unsigned long long seed);
 SampledGraph *randomly_sample_graph(const char *filename, int total_graphs);
 
 void *worker_thread(void *arg);
+void init_work_queue(WorkQueue *q, int n_threads, int total);
+void destroy_work_queue(WorkQueue *q);
+bool next_work_chunk(WorkQueue *q, int self, int *begin, int *end,
+                     bool *stolen);
+// Streaming expand -> dedup pipeline (hra_pipeline.c)
+int run_pipeline(WorkerThread *args, int num_threads);
+
+// Multi-generation chain (hra_chain.c)
+int run_evolution_chain(const HrabRecord *sources, int n_sources,
+                        int start_size, int target_size, int num_threads,
+                        const char *output_dir, bool checkpoint);
+
+// Coverage by node deletion from the reference set (hra_reverse.c)
+int run_reverse_coverage(const HrabRecord *sources, int n_sources,
+                         int start_size, int target_size, int num_threads,
+                         const char *output_dir);
 int expand_graph_to_size(const Graph *base_graph, int target_size,
                          const char *output_dir, int thread_id);
 
@@ -113,6 +265,11 @@ int analyze_results(const char *results_dir, int original_size, int target_size,
 void print_analysis_summary(const UniqueGraphSet *all_unique,
                             const UniqueGraphSet *from_n3, int total_n4_hra,
                             int n, int target_n);
+int reference_hra_count(int n);
+int reference_hra_file(int n, char *path, size_t size);
+void report_analysis(const UniqueGraphSet *all_unique,
+                     const UniqueGraphSet *from_sources, int original_size,
+                     int target_size);
 
 bool next_permutation(int *arr, int n);
 void init_graph(Graph *g, int n_nodes);
@@ -120,9 +277,15 @@ void add_edge(Graph *g, int from, int to, int regulation);
 bool is_weakly_connected(const Graph *g);
 bool is_heritable_topology(const Graph *g);
 bool is_heritable_regulatory(const Graph *g);
+double wall_time_seconds(void);
 
-// Functions for the expander subprocess
-void expand_single_graph(const Graph *base, int target_size, FILE *output,
+// Expansion library (hra_expand.c), run in-process by the runner's workers
+// or by the hra_expander subprocess
+int expand_graph_to_file(const Graph *base, int source_id, int start_size,
+                         int target_size, const char *output_file);
+ExpandSink dot_expand_sink(FILE *fp);
+ExpandSink hrab_expand_sink(HrabWriter *w);
+void expand_single_graph(const Graph *base, int target_size, ExpandSink *sink,
                          int *counter, int source_id);
 void expand_single_graph_limited(const Graph *base, int target_size,
                                  FILE *output, int *counter, int source_id);
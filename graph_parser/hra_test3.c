@@ -6,6 +6,9 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <time.h>
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
 
 // Union-Find with path compression
 static int uf_find(int *parent, int x) {
@@ -103,73 +106,189 @@ bool is_heritable_regulatory(Graph *g) {
   return true;
 }
 
-// Canonical representation
+// Packed copy of g for the validity checks and canonicalization
+void graph_to_packed(const Graph *g, PackedGraph *pg) {
+  packed_from_adjacency(pg, g->n_nodes, &g->adj_matrix[0][0], MAX_NODES);
+}
+
+// Canonical representation (partition refinement, see hra_packed.c)
 void compute_canonical_rep(Graph *g, int *canon) {
-  int n = g->n_nodes;
-  int perm[MAX_NODES], best[MAX_NODES * MAX_NODES],
-      current[MAX_NODES * MAX_NODES];
+  PackedGraph pg;
+  graph_to_packed(g, &pg);
+  packed_canonical_rep(&pg, canon);
+}
+
+// Orderly generation of topologies (McKay's canonical augmentation).
+//
+// Every digraph on n nodes is grown from the empty graph one edge at a time.
+// A child P + e is kept only if e lies in the automorphism orbit of the
+// child's canonical deletion edge (the last edge of its canonical form), so
+// each isomorphism class is generated exactly once, from a single parent,
+// and no seen table is needed. Non-edges of P in the same Aut(P) orbit give
+// isomorphic children, so only the first of each orbit is tried. Both orbit
+// tests mark the edge black and compare canonical keys: two edges get the
+// same key exactly when an automorphism maps one onto the other.
+
+// Canonical key of g with from -> to added (or recoloured) black
+static void marked_key(const PackedGraph *g, int from, int to, int *key) {
+  PackedGraph marked = *g;
+  if (!((marked.out[from] >> to) & 1))
+    packed_add_edge(&marked, from, to, 1);
+  else
+    marked.black[from] |= (NodeMask)(1u << to);
+  packed_canonical_rep(&marked, key);
+}
+
+static unsigned long long hash_ints(const int *key, int len) {
+  unsigned long long h = 1469598103934665603ULL;
+  for (int i = 0; i < len; i++) {
+    h ^= (unsigned char)key[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+// Accepted children of g, i.e. g plus one canonical edge
+int orderly_children(const PackedGraph *g, PackedGraph *children) {
+  int n = g->n_nodes, len = n * n;
+  unsigned long long tried_hash[MAX_EDGES];
+  int tried_from[MAX_EDGES], tried_to[MAX_EDGES];
+  int n_tried = 0, n_children = 0;
   for (int i = 0; i < n; i++)
-    perm[i] = i;
-  memset(best, 0, sizeof(best));
-  bool first = true;
-  do {
-    for (int i = 0; i < n; i++)
-      for (int j = 0; j < n; j++)
-        current[i * n + j] = g->adj_matrix[perm[i]][perm[j]];
-    if (first || memcmp(current, best, n * n * sizeof(int)) < 0) {
-      memcpy(best, current, n * n * sizeof(int));
-      first = false;
-    }
-  } while (next_permutation(perm, n));
-  memcpy(canon, best, n * n * sizeof(int));
-}
-
-// Generate all possible edges
-int generate_all_edges(int n, Edge *all_edges) {
-  int cnt = 0;
-  for (int i = 0; i < n && cnt < MAX_EDGES; i++)
-    for (int j = 0; j < n && cnt < MAX_EDGES; j++)
-      if (i != j)
-        all_edges[cnt++] = (Edge){i, j, 0};
-  return cnt;
-}
-
-// Generate edge combinations for canonical topologies
-void generate_edge_combinations(Edge *all_edges, int total_edges, int k,
-                                int start, Edge *current_combo, int combo_idx,
-                                GraphCollection *topologies, int n_nodes,
-                                int *seen_reps, long long *seen_count) {
-  if (combo_idx == k) {
-    Graph g;
-    init_graph(&g, n_nodes);
-    for (int i = 0; i < k; i++)
-      add_edge(&g, current_combo[i].from, current_combo[i].to, 0);
-    if (is_weakly_connected(&g) && is_heritable_topology(&g)) {
-      int canon[MAX_NODES * MAX_NODES];
-      compute_canonical_rep(&g, canon);
-      bool found = false;
-      for (long long i = 0; i < *seen_count; i++) {
-        if (memcmp(seen_reps + i * MAX_NODES * MAX_NODES, canon,
-                   n_nodes * n_nodes * sizeof(int)) == 0) {
-          found = true;
-          break;
-        }
+    for (int j = 0; j < n; j++) {
+      if (i == j || ((g->out[i] >> j) & 1))
+        continue;
+
+      // Skip non-edges equivalent to one already tried
+      int key[MAX_NODES * MAX_NODES], other[MAX_NODES * MAX_NODES];
+      marked_key(g, i, j, key);
+      unsigned long long h = hash_ints(key, len);
+      bool repeat = false;
+      for (int t = 0; t < n_tried && !repeat; t++) {
+        if (tried_hash[t] != h)
+          continue;
+        marked_key(g, tried_from[t], tried_to[t], other);
+        repeat = memcmp(key, other, len * sizeof(int)) == 0;
       }
-      if (!found && *seen_count < MAX_GRAPHS) {
-        memcpy(seen_reps + (*seen_count) * MAX_NODES * MAX_NODES, canon,
-               n_nodes * n_nodes * sizeof(int));
-        (*seen_count)++;
-        add_graph_to_collection(topologies, &g);
+      if (repeat)
+        continue;
+      tried_hash[n_tried] = h;
+      tried_from[n_tried] = i;
+      tried_to[n_tried] = j;
+      n_tried++;
+
+      PackedGraph child = *g;
+      packed_add_edge(&child, i, j, 0);
+      int lab[MAX_NODES];
+      packed_canonical_labeling(&child, key, lab);
+      int last = len - 1;
+      while (key[last] != 0)
+        last--;
+      int del_from = lab[last / n], del_to = lab[last % n];
+      if (del_from != i || del_to != j) {
+        marked_key(&child, i, j, key);
+        marked_key(&child, del_from, del_to, other);
+        if (memcmp(key, other, len * sizeof(int)) != 0)
+          continue;
       }
+      children[n_children++] = child;
     }
-    return;
-  }
-  for (int i = start; i < total_edges; i++) {
-    current_combo[combo_idx] = all_edges[i];
-    generate_edge_combinations(all_edges, total_edges, k, i + 1, current_combo,
-                               combo_idx + 1, topologies, n_nodes, seen_reps,
-                               seen_count);
-  }
+  return n_children;
+}
+
+// The topology search runs in the deletion direction: the orderly tree is
+// grown over complements, so each step removes one canonical edge from the
+// topology, starting from the complete digraph. Weak connectivity and
+// nonzero in-degrees can only be lost by removing edges, so a topology that
+// fails either has no valid topology anywhere below it, and its whole
+// subtree is cut. Every valid topology keeps its ancestors valid, so the cut
+// is exact.
+
+// The topology of complement tree node q: every edge q lacks
+static void complement_topology(const PackedGraph *q, PackedGraph *t) {
+  int n = q->n_nodes;
+  packed_init(t, n);
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+      if (i != j && !((q->out[i] >> j) & 1))
+        packed_add_edge(t, i, j, 0);
+}
+
+// Keep t if it is a valid topology. The stored Graph is the canonical form,
+// which for an all-gray graph is also the lexicographically first edge
+// combination in its class. *viable is false when no subgraph of t can be
+// valid either.
+static bool collect_topology(const PackedGraph *t, GraphCollection *out,
+                             bool *viable) {
+  int n = t->n_nodes;
+  *viable = packed_is_weakly_connected(t) && packed_is_heritable_topology(t);
+  if (!*viable)
+    return true;
+  int canon[MAX_NODES * MAX_NODES];
+  packed_canonical_rep(t, canon);
+  Graph g;
+  init_graph(&g, n);
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+      if (canon[i * n + j] == 0)
+        add_edge(&g, i, j, 0);
+  return add_graph_to_collection(out, &g);
+}
+
+// Depth-first generation below complement node q; levels holds scratch
+// space for the children at each edge count. visited counts the search tree
+// nodes reached, including the cut ones.
+static bool orderly_search(const PackedGraph *q,
+                           PackedGraph (*levels)[MAX_EDGES],
+                           GraphCollection *out, unsigned long long *visited) {
+  (*visited)++;
+  PackedGraph t;
+  bool viable;
+  complement_topology(q, &t);
+  if (!collect_topology(&t, out, &viable))
+    return false;
+  if (!viable)
+    return true;
+  PackedGraph *children = levels[q->n_edges];
+  int n_children = orderly_children(q, children);
+  for (int c = 0; c < n_children; c++)
+    if (!orderly_search(&children[c], levels, out, visited))
+      return false;
+  return true;
+}
+
+// Order of the old edge-combination enumeration: by edge count, then by
+// canonical form (row-major, edges first)
+static int compare_topologies(const void *a, const void *b) {
+  const Graph *ga = a, *gb = b;
+  if (ga->n_edges != gb->n_edges)
+    return ga->n_edges - gb->n_edges;
+  for (int i = 0; i < ga->n_nodes; i++)
+    for (int j = 0; j < ga->n_nodes; j++)
+      if (ga->adj_matrix[i][j] != gb->adj_matrix[i][j])
+        return ga->adj_matrix[i][j] == 0 ? -1 : 1;
+  return 0;
+}
+
+void sort_topologies(GraphCollection *topologies) {
+  qsort(topologies->graphs, topologies->count, sizeof(Graph),
+        compare_topologies);
+}
+
+// All canonical topologies on n nodes, sorted
+bool generate_topologies(int n, GraphCollection *topologies,
+                         unsigned long long *search_nodes) {
+  PackedGraph(*levels)[MAX_EDGES] =
+      malloc((MAX_EDGES + 1) * sizeof(*levels));
+  if (!levels)
+    return false;
+  // The empty complement: the complete digraph
+  PackedGraph empty;
+  packed_init(&empty, n);
+  bool ok = orderly_search(&empty, levels, topologies, search_nodes);
+  free(levels);
+  sort_topologies(topologies);
+  return ok;
 }
 
 // Write Graph to DOT format
@@ -182,57 +301,223 @@ void write_graph_dot(Graph *g, FILE *f, int id, int n) {
   fprintf(f, "}\n");
 }
 
-// Generate all regulatory architectures from a topology, storing HRAs
-void generate_all_regulatory_from_topology(
-    Graph *topology, unsigned long long *all_ras_count,
-    unsigned long long *hras_count, int *global_seen_reps,
-    long long *global_seen_count, int *hra_seen_reps, long long *hra_seen_count,
-    GraphCollection *hra_collection) {
+static bool append_pattern(PatternList *pl, unsigned long long pat) {
+  if (pl->count >= pl->capacity) {
+    long long new_capacity = pl->capacity ? pl->capacity * 2 : 64;
+    unsigned long long *patterns =
+        realloc(pl->patterns, new_capacity * sizeof(unsigned long long));
+    if (!patterns)
+      return false;
+    pl->patterns = patterns;
+    pl->capacity = new_capacity;
+  }
+  pl->patterns[pl->count++] = pat;
+  return true;
+}
+
+// Append one HRA (topology labelled by pat) to the DOT file or .hrab output,
+// or to the deferred pattern list; false if it could not be recorded
+static bool write_hra(HraOutput *out, Graph *topology,
+                      unsigned long long pat, int n) {
+  if (out->deferred)
+    return append_pattern(out->deferred, pat);
+  Graph g = *topology;
+  for (int i = 0; i < g.n_edges; i++) {
+    int r = (pat >> i) & 1;
+    g.edges[i].regulation = r;
+    g.adj_matrix[g.edges[i].from][g.edges[i].to] = r;
+  }
+  out->written++;
+  if (out->hrab) {
+    HrabRecord rec;
+    hrab_encode(&rec, n, &g.adj_matrix[0][0], MAX_NODES, HRAB_NO_SOURCE);
+    return hrab_write(out->hrab, &rec);
+  }
+  if (out->dot) {
+    if (out->written > 1)
+      fprintf(out->dot, "\n");
+    write_graph_dot(&g, out->dot, (int)out->written, n);
+    return !ferror(out->dot);
+  }
+  return true;
+}
+
+// Labelings modulo topology automorphisms.
+//
+// Two labelings of the same topology are isomorphic exactly when an
+// automorphism of the topology maps one onto the other, so the distinct
+// regulatory architectures of a topology are the orbits of Aut(topology) on
+// its 2^e label patterns. Each orbit is represented by its smallest pattern,
+// which is also the one the pattern loop meets first, so the output is the
+// same as deduplicating by canonical form. Architectures of different
+// topologies never coincide.
+
+// Extend the partial automorphism perm[0..i-1] of g; stores every
+// non-identity automorphism found
+static bool extend_automorphism(const Graph *t, const PackedGraph *g,
+                                int *perm, NodeMask used, int i,
+                                int (**autos)[MAX_NODES], int *count,
+                                int *capacity) {
+  int n = g->n_nodes;
+  if (i == n) {
+    bool identity = true;
+    for (int j = 0; j < n && identity; j++)
+      identity = perm[j] == j;
+    if (identity)
+      return true;
+    if (*count >= *capacity) {
+      int new_capacity = *capacity ? 2 * *capacity : 16;
+      int(*tmp)[MAX_NODES] = realloc(*autos, new_capacity * sizeof(**autos));
+      if (!tmp)
+        return false;
+      *autos = tmp;
+      *capacity = new_capacity;
+    }
+    memcpy((*autos)[(*count)++], perm, n * sizeof(int));
+    return true;
+  }
+  for (int v = 0; v < n; v++) {
+    if (((used >> v) & 1) || t->in_degree[v] != t->in_degree[i] ||
+        t->out_degree[v] != t->out_degree[i])
+      continue;
+    bool ok = true;
+    for (int j = 0; j < i && ok; j++)
+      ok = ((g->out[i] >> j) & 1) == ((g->out[v] >> perm[j]) & 1) &&
+           ((g->out[j] >> i) & 1) == ((g->out[perm[j]] >> v) & 1);
+    if (!ok)
+      continue;
+    perm[i] = v;
+    if (!extend_automorphism(t, g, perm, used | (NodeMask)(1u << v), i + 1,
+                             autos, count, capacity))
+      return false;
+  }
+  return true;
+}
+
+bool build_label_group(const Graph *topology, LabelGroup *lg) {
+  lg->count = 0;
+  lg->tables = NULL;
+  int e = topology->n_edges;
+  PackedGraph g;
+  graph_to_packed(topology, &g);
+  int perm[MAX_NODES];
+  int(*autos)[MAX_NODES] = NULL;
+  int count = 0, capacity = 0;
+  if (!extend_automorphism(topology, &g, perm, 0, 0, &autos, &count,
+                           &capacity)) {
+    free(autos);
+    return false;
+  }
+  if (count == 0)
+    return true;
+
+  lg->tables = calloc(count, sizeof(*lg->tables));
+  if (!lg->tables) {
+    free(autos);
+    return false;
+  }
+  int edge_index[MAX_NODES][MAX_NODES];
+  for (int k = 0; k < e; k++)
+    edge_index[topology->edges[k].from][topology->edges[k].to] = k;
+  for (int a = 0; a < count; a++)
+    for (int k = 0; k < e; k++) {
+      int image = edge_index[autos[a][topology->edges[k].from]]
+                            [autos[a][topology->edges[k].to]];
+      for (unsigned int x = 0; x < 256; x++)
+        if ((x >> (k % 8)) & 1)
+          lg->tables[a][k / 8][x] |= 1u << image;
+    }
+  lg->count = count;
+  free(autos);
+  return true;
+}
+
+void free_label_group(LabelGroup *lg) {
+  free(lg->tables);
+  lg->tables = NULL;
+  lg->count = 0;
+}
+
+// True if no automorphism maps pat to a smaller pattern
+bool is_orbit_representative(const LabelGroup *lg, unsigned int pat) {
+  for (int a = 0; a < lg->count; a++) {
+    const unsigned int(*t)[256] = lg->tables[a];
+    unsigned int image = t[0][pat & 255] | t[1][(pat >> 8) & 255] |
+                         t[2][(pat >> 16) & 255] | t[3][pat >> 24];
+    if (image < pat)
+      return false;
+  }
+  return true;
+}
+
+// Generate all regulatory architectures from a topology, streaming HRAs.
+// Returns false if the automorphism group could not be built or an HRA
+// could not be written.
+bool generate_all_regulatory_from_topology(Graph *topology,
+                                           unsigned long long *all_ras_count,
+                                           unsigned long long *hras_count,
+                                           HraOutput *hra_out) {
   int n = topology->n_nodes, e = topology->n_edges;
   if (e > 32)
-    return;
+    return true;
+  LabelGroup group;
+  if (!build_label_group(topology, &group))
+    return false;
+  // Gray in-edges per node, and the number of nodes with none. Pattern 0 is
+  // all gray.
+  int gray_in[MAX_NODES];
+  memcpy(gray_in, topology->in_degree, sizeof(gray_in));
+  int uncovered = 0;
   unsigned long long total = 1ULL << e;
   for (unsigned long long pat = 0; pat < total; pat++) {
-    Graph reg = *topology;
-    for (int i = 0; i < e; i++) {
-      int r = (pat >> i) & 1;
-      reg.edges[i].regulation = r;
-      reg.adj_matrix[reg.edges[i].from][reg.edges[i].to] = r;
-    }
-    int canon[MAX_NODES * MAX_NODES];
-    compute_canonical_rep(&reg, canon);
-    bool seen = false;
-    for (long long i = 0; i < *global_seen_count; i++) {
-      if (memcmp(global_seen_reps + i * MAX_NODES * MAX_NODES, canon,
-                 n * n * sizeof(int)) == 0) {
-        seen = true;
-        break;
-      }
+    if (pat > 0) {
+      // pat - 1 -> pat turns the trailing black labels gray and the next
+      // gray one black: two flips per pattern on average, and the pattern
+      // order (hence the output) stays the same as before
+      int i = 0;
+      for (; !((pat >> i) & 1); i++)
+        if (gray_in[topology->edges[i].to]++ == 0)
+          uncovered--;
+      if (--gray_in[topology->edges[i].to] == 0)
+        uncovered++;
     }
-    if (!seen && *global_seen_count < MAX_GRAPHS) {
-      memcpy(global_seen_reps + (*global_seen_count) * MAX_NODES * MAX_NODES,
-             canon, n * n * sizeof(int));
-      (*global_seen_count)++;
-      (*all_ras_count)++;
-      if (is_heritable_regulatory(&reg)) {
-        bool hra_seen = false;
-        for (long long i = 0; i < *hra_seen_count; i++) {
-          if (memcmp(hra_seen_reps + i * MAX_NODES * MAX_NODES, canon,
-                     n * n * sizeof(int)) == 0) {
-            hra_seen = true;
-            break;
-          }
-        }
-        if (!hra_seen && *hra_seen_count < MAX_GRAPHS) {
-          memcpy(hra_seen_reps + (*hra_seen_count) * MAX_NODES * MAX_NODES,
-                 canon, n * n * sizeof(int));
-          (*hra_seen_count)++;
-          (*hras_count)++;
-          add_graph_to_collection(hra_collection, &reg);
-        }
+    if (!is_orbit_representative(&group, (unsigned int)pat))
+      continue;
+    (*all_ras_count)++;
+    if (uncovered == 0) {
+      (*hras_count)++;
+      // HRAs are streamed straight to the output instead of being kept
+      if (hra_out && !write_hra(hra_out, topology, pat, n)) {
+        free_label_group(&group);
+        return false;
       }
     }
   }
+  free_label_group(&group);
+  return true;
+}
+
+// Peak resident set size of this process in MB (-1 if unavailable)
+double peak_rss_mb(void) {
+#if !defined(_WIN32)
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0)
+    return -1.0;
+#if defined(__APPLE__)
+  return ru.ru_maxrss / (1024.0 * 1024.0); // bytes on macOS
+#else
+  return ru.ru_maxrss / 1024.0; // kilobytes on Linux
+#endif
+#else
+  return -1.0;
+#endif
+}
+
+// Monotonic wall-clock time; clock() would sum CPU time across -j threads
+double wall_time_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
 // Create graph collection
@@ -284,8 +569,349 @@ bool add_graph_to_collection(GraphCollection *gc, Graph *g) {
   return true;
 }
 
+// -j thread pool.
+//
+// Topologies: each task is one subtree of the orderly generation tree.
+// Subtrees never share a class, so the thread results are simply pooled and
+// sorted into the single-threaded order.
+//
+// Regulatory architectures: each task is one topology, whose labelings are
+// deduplicated by its own automorphism group. Workers record the HRA label
+// patterns and the main thread writes each topology's HRAs once it and all
+// earlier topologies are finished.
+
+static int take_task(ParallelRun *run, int n_tasks) {
+  pthread_mutex_lock(&run->lock);
+  int task = (run->next_task < n_tasks && !run->failed) ? run->next_task++
+                                                         : -1;
+  pthread_mutex_unlock(&run->lock);
+  return task;
+}
+
+static void mark_failed(ParallelRun *run) {
+  pthread_mutex_lock(&run->lock);
+  run->failed = true;
+  pthread_cond_broadcast(&run->task_done);
+  pthread_mutex_unlock(&run->lock);
+}
+
+static void *topology_worker(void *arg) {
+  ParallelRun *run = arg;
+  PackedGraph(*levels)[MAX_EDGES] =
+      malloc((MAX_EDGES + 1) * sizeof(*levels));
+  GraphCollection *found = create_graph_collection();
+  bool ok = levels && found;
+  unsigned long long visited = 0;
+  int task;
+  while (ok && (task = take_task(run, run->n_frontier)) >= 0)
+    ok = orderly_search(&run->frontier[task], levels, found, &visited);
+
+  pthread_mutex_lock(&run->lock);
+  run->search_nodes += visited;
+  for (int i = 0; ok && i < found->count; i++)
+    ok = add_graph_to_collection(run->topologies, &found->graphs[i]);
+  pthread_mutex_unlock(&run->lock);
+  if (!ok)
+    mark_failed(run);
+  free(levels);
+  free_graph_collection(found);
+  return NULL;
+}
+
+static void *regulatory_worker(void *arg) {
+  ParallelRun *run = arg;
+  int task;
+  while ((task = take_task(run, run->topologies->count)) >= 0) {
+    unsigned long long ras = 0, hras = 0;
+    HraOutput deferred = {NULL, NULL, 0, &run->hra_patterns[task]};
+    if (!generate_all_regulatory_from_topology(
+            &run->topologies->graphs[task], &ras, &hras, &deferred)) {
+      mark_failed(run);
+      break;
+    }
+    pthread_mutex_lock(&run->lock);
+    run->ras_counts[task] = ras;
+    run->done[task] = true;
+    pthread_cond_broadcast(&run->task_done);
+    pthread_mutex_unlock(&run->lock);
+  }
+  return NULL;
+}
+
+static bool run_workers(ParallelRun *run, int jobs, void *(*worker)(void *)) {
+  pthread_t threads[MAX_JOBS];
+  int started = 0;
+  run->next_task = 0;
+  for (; started < jobs; started++)
+    if (pthread_create(&threads[started], NULL, worker, run) != 0)
+      break;
+  if (started == 0)
+    return false;
+  for (int i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+  return !run->failed;
+}
+
+// Topology phase: expand level by level until there are enough subtrees to
+// share out, then search the subtrees in parallel. Sorting afterwards gives
+// the same list as the sequential run.
+static bool parallel_topologies(ParallelRun *run, int jobs) {
+  int target = 64 * jobs;
+  int level_cap = 1, next_cap = 64;
+  PackedGraph *level = malloc(level_cap * sizeof(PackedGraph));
+  PackedGraph *next = malloc(next_cap * sizeof(PackedGraph));
+  bool ok = level && next;
+  int n_level = 0;
+  if (ok) {
+    packed_init(&level[0], run->n);
+    n_level = 1;
+  }
+  while (ok && n_level > 0 && n_level < target) {
+    int n_next = 0;
+    run->search_nodes += n_level;
+    for (int g = 0; ok && g < n_level; g++) {
+      PackedGraph t;
+      bool viable;
+      complement_topology(&level[g], &t);
+      ok = collect_topology(&t, run->topologies, &viable);
+      if (!viable)
+        continue;
+      if (n_next + MAX_EDGES > next_cap) {
+        next_cap = 2 * (n_next + MAX_EDGES);
+        PackedGraph *tmp = realloc(next, next_cap * sizeof(PackedGraph));
+        if (!tmp) {
+          ok = false;
+          break;
+        }
+        next = tmp;
+      }
+      n_next += orderly_children(&level[g], next + n_next);
+    }
+    PackedGraph *tmp = level;
+    level = next;
+    next = tmp;
+    int tmp_cap = level_cap;
+    level_cap = next_cap;
+    next_cap = tmp_cap;
+    n_level = n_next;
+  }
+
+  if (ok && n_level > 0) {
+    run->frontier = level;
+    run->n_frontier = n_level;
+    ok = run_workers(run, jobs, topology_worker);
+    run->frontier = NULL;
+  }
+  free(level);
+  free(next);
+  sort_topologies(run->topologies);
+  return ok;
+}
+
+// Regulatory phase: workers run ahead while this thread writes the HRAs
+// of each topology in order
+static bool parallel_regulatory(ParallelRun *run, int jobs, bool verbose,
+                                unsigned long long *all_ras_count,
+                                unsigned long long *hras_count,
+                                HraOutput *hra_out) {
+  int count = run->topologies->count;
+  run->ras_counts = calloc(count > 0 ? count : 1, sizeof(unsigned long long));
+  run->hra_patterns = calloc(count > 0 ? count : 1, sizeof(PatternList));
+  run->done = calloc(count > 0 ? count : 1, sizeof(bool));
+  run->next_task = 0;
+  bool ok = run->ras_counts && run->hra_patterns && run->done;
+
+  pthread_t threads[MAX_JOBS];
+  int started = 0;
+  for (; ok && started < jobs; started++)
+    if (pthread_create(&threads[started], NULL, regulatory_worker, run) != 0)
+      break;
+  ok = ok && started > 0;
+
+  for (int i = 0; ok && i < count; i++) {
+    pthread_mutex_lock(&run->lock);
+    while (!run->done[i] && !run->failed)
+      pthread_cond_wait(&run->task_done, &run->lock);
+    ok = !run->failed;
+    pthread_mutex_unlock(&run->lock);
+    if (!ok)
+      break;
+
+    if (verbose && (i % 100 == 0 || i == count - 1))
+      printf("Processing topology %d/%d...\n", i + 1, count);
+    PatternList *pl = &run->hra_patterns[i];
+    *all_ras_count += run->ras_counts[i];
+    *hras_count += (unsigned long long)pl->count;
+    for (long long p = 0; ok && hra_out && p < pl->count; p++)
+      ok = write_hra(hra_out, &run->topologies->graphs[i], pl->patterns[p],
+                     run->n);
+    free(pl->patterns);
+    pl->patterns = NULL;
+  }
+  if (!ok)
+    mark_failed(run);
+  for (int i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+
+  for (int i = 0; run->hra_patterns && i < count; i++)
+    free(run->hra_patterns[i].patterns);
+  free(run->ras_counts);
+  free(run->hra_patterns);
+  free(run->done);
+  return ok;
+}
+
+// Counting by cycle index (--count-only).
+//
+// The counts come from Burnside's lemma over S_n acting on labelled graphs,
+// without enumerating anything. Every ordered pair of distinct nodes takes
+// one of k states (absent or present; absent, gray or black), and a graph is
+// fixed by a permutation exactly when the states are constant on its orbits
+// of pairs. The per-node conditions (some in-edge; some gray in-edge) then
+// factor over the node cycles: the in-pairs of a cycle fall into o orbits,
+// at least one of which must avoid the b bad states, so the cycle allows
+// k^o - b^o choices. This counts graphs whose every weak component has the
+// property; the connected ones follow by inverting the Euler transform.
+
+static int count_gcd(int a, int b) {
+  while (b) {
+    int t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+static CountInt count_power(int base, int exp) {
+  CountInt p = 1;
+  for (int i = 0; i < exp; i++)
+    p *= (CountInt)base;
+  return p;
+}
+
+// Graphs fixed by a permutation with cycles of lengths len[0..cycles-1]
+static CountInt count_fixed(const int *len, int cycles, int states,
+                            int bad) {
+  CountInt fixed = 1;
+  for (int t = 0; t < cycles; t++) {
+    // Pairs inside the cycle, then pairs from each other cycle
+    int orbits = len[t] - 1;
+    for (int s = 0; s < cycles; s++)
+      if (s != t)
+        orbits += count_gcd(len[s], len[t]);
+    fixed *= count_power(states, orbits) - count_power(bad, orbits);
+  }
+  return fixed;
+}
+
+// Sum of fixed graphs over all permutations of n nodes, walking the cycle
+// types as non-increasing partitions; len[0..cycles-1] is the prefix so far
+static CountInt count_cycle_types(int n, int *len, int cycles, int remaining,
+                                  int states, int bad) {
+  if (remaining == 0) {
+    // n! / z, z = prod over part sizes k of k^m_k * m_k!
+    CountInt perms = 1;
+    for (int i = 2; i <= n; i++)
+      perms *= (CountInt)i;
+    for (int i = 0, run = 0; i < cycles; i++) {
+      run = (i > 0 && len[i] == len[i - 1]) ? run + 1 : 1;
+      perms /= (CountInt)len[i] * (CountInt)run;
+    }
+    return perms * count_fixed(len, cycles, states, bad);
+  }
+  int max_part = cycles ? len[cycles - 1] : n;
+  if (max_part > remaining)
+    max_part = remaining;
+  CountInt total = 0;
+  for (int part = max_part; part >= 1; part--) {
+    len[cycles] = part;
+    total += count_cycle_types(n, len, cycles + 1, remaining - part, states,
+                               bad);
+  }
+  return total;
+}
+
+static int count_mobius(int n) {
+  int mu = 1;
+  for (int p = 2; p * p <= n; p++)
+    if (n % p == 0) {
+      n /= p;
+      if (n % p == 0)
+        return 0;
+      mu = -mu;
+    }
+  return n > 1 ? -mu : mu;
+}
+
+// Connected graphs on n nodes in which every node has an in-edge in one of
+// the states - bad good states, up to isomorphism
+CountInt count_connected_graphs(int n, int states, int bad) {
+  // all[m]: graphs on m nodes with any number of such components
+  CountInt all[MAX_NODES + 1], euler[MAX_NODES + 1];
+  int len[MAX_NODES];
+  CountInt factorial = 1;
+  all[0] = 1;
+  for (int m = 1; m <= n; m++) {
+    factorial *= (CountInt)m;
+    all[m] = count_cycle_types(m, len, 0, m, states, bad) / factorial;
+  }
+  // m * all[m] = sum over k of euler[k] * all[m - k], where
+  // euler[k] = sum over d | k of d * connected[d]
+  for (int m = 1; m <= n; m++) {
+    euler[m] = (CountInt)m * all[m];
+    for (int k = 1; k < m; k++)
+      euler[m] -= euler[k] * all[m - k];
+  }
+  // Mobius inversion; the negative terms are kept apart as CountInt may be
+  // unsigned
+  CountInt plus = 0, minus = 0;
+  for (int d = 1; d <= n; d++) {
+    if (n % d != 0)
+      continue;
+    int mu = count_mobius(n / d);
+    if (mu > 0)
+      plus += euler[d];
+    else if (mu < 0)
+      minus += euler[d];
+  }
+  return (plus - minus) / (CountInt)n;
+}
+
+static const char *format_count(CountInt v, char *buf, size_t size) {
+  char digits[48];
+  int len = 0;
+  do {
+    digits[len++] = (char)('0' + (int)(v % 10));
+    v /= 10;
+  } while (v > 0);
+  size_t i = 0;
+  for (; i + 1 < size && len > 0; i++)
+    buf[i] = digits[--len];
+  buf[i] = '\0';
+  return buf;
+}
+
+// Print the generate_hras totals for n without generating anything
+void count_hras(int n) {
+  double start_time = wall_time_seconds();
+  CountInt topologies = count_connected_graphs(n, 2, 1);
+  CountInt ras = count_connected_graphs(n, 3, 1);
+  CountInt hras = count_connected_graphs(n, 3, 2);
+  double elapsed = wall_time_seconds() - start_time;
+
+  char buf[48];
+  printf("\nCounts for n=%d (Burnside, nothing generated):\n", n);
+  printf("  Canonical topologies: %s\n",
+         format_count(topologies, buf, sizeof(buf)));
+  printf("  Total regulatory architectures: %s\n",
+         format_count(ras, buf, sizeof(buf)));
+  printf("  Heritable regulatory architectures (HRAs): %s\n",
+         format_count(hras, buf, sizeof(buf)));
+  printf("  Time: %.4f seconds\n", elapsed);
+}
+
 // Main optimized HRA generation with per-file DOT export and directory
-void generate_hras(int n, bool verbose) {
+void generate_hras(int n, bool verbose, bool binary, int jobs) {
   if (n <= 0 || n > MAX_NODES) {
     printf("Error: n must be between 1 and %d\n", MAX_NODES);
     return;
@@ -302,110 +928,108 @@ void generate_hras(int n, bool verbose) {
     exit(1);
   }
 
-  // Allocate reps arrays
-  int *seen_reps = malloc(MAX_GRAPHS * MAX_NODES * MAX_NODES * sizeof(int));
-  int *global_seen_reps =
-      malloc(MAX_GRAPHS * MAX_NODES * MAX_NODES * sizeof(int));
-  int *hra_seen_reps = malloc(MAX_GRAPHS * MAX_NODES * MAX_NODES * sizeof(int));
-
-  if (!seen_reps || !global_seen_reps || !hra_seen_reps) {
-    printf("Memory allocation failed\n");
-    free(seen_reps);
-    free(global_seen_reps);
-    free(hra_seen_reps);
-    return;
-  }
-
-  // Create graph collections on heap
+  // Only topologies are collected; HRAs are streamed to the output file
   GraphCollection *topologies = create_graph_collection();
-  GraphCollection *hra_collection = create_graph_collection();
-
-  if (!topologies || !hra_collection) {
+  if (!topologies) {
     printf("Failed to create graph collections\n");
-    free(seen_reps);
-    free(global_seen_reps);
-    free(hra_seen_reps);
-    if (topologies)
-      free_graph_collection(topologies);
-    if (hra_collection)
-      free_graph_collection(hra_collection);
     return;
   }
 
-  long long seen_count = 0;
-  long long global_seen_count = 0;
-  long long hra_seen_count = 0;
+  char filename[256];
+  snprintf(filename, sizeof(filename), "%s/hras_n%d.%s", out_dir, n,
+           binary ? "hrab" : "dot");
+  HraOutput hra_out = {NULL, NULL, 0, NULL};
+  if (binary)
+    hra_out.hrab = hrab_open_writer(filename);
+  else
+    hra_out.dot = fopen(filename, "w");
+  bool output_open = hra_out.hrab || hra_out.dot;
+  if (!output_open)
+    printf("Failed to open %s for writing\n", filename);
+
   unsigned long long all_ras_count = 0;
   unsigned long long hras_count = 0;
 
-  clock_t start_time = clock();
+  double start_time = wall_time_seconds();
 
-  // Generate all possible edges
-  Edge all_edges[MAX_EDGES];
-  int total_edges = generate_all_edges(n, all_edges);
+  ParallelRun run;
+  if (jobs > 1) {
+    memset(&run, 0, sizeof(run));
+    run.n = n;
+    run.topologies = topologies;
+    pthread_mutex_init(&run.lock, NULL);
+    pthread_cond_init(&run.task_done, NULL);
+  }
+  bool ok = true;
+  unsigned long long search_nodes = 0;
 
   printf("Generating topologies for n=%d...\n", n);
 
-  // Generate all valid topologies with different numbers of edges
-  for (int k = n; k <= total_edges; k++) {
-    Edge current_combo[MAX_EDGES];
-    generate_edge_combinations(all_edges, total_edges, k, 0, current_combo, 0,
-                               topologies, n, seen_reps, &seen_count);
+  // Orderly generation yields each topology class once
+  if (jobs > 1) {
+    ok = parallel_topologies(&run, jobs);
+    search_nodes = run.search_nodes;
+  } else {
+    ok = generate_topologies(n, topologies, &search_nodes);
   }
 
-  printf("Found %d canonical topologies\n", topologies->count);
+  printf("Found %d canonical topologies (%llu search nodes visited)\n",
+         topologies->count, search_nodes);
 
   // Generate all regulatory architectures from each topology
-  for (int i = 0; i < topologies->count; i++) {
-    if (verbose && (i % 100 == 0 || i == topologies->count - 1)) {
-      printf("Processing topology %d/%d...\n", i + 1, topologies->count);
-    }
-    generate_all_regulatory_from_topology(
-        &topologies->graphs[i], &all_ras_count, &hras_count, global_seen_reps,
-        &global_seen_count, hra_seen_reps, &hra_seen_count, hra_collection);
-  }
-
-  // Write HRA graphs to DOT files
-  if (hra_collection->count > 0) {
-    char filename[256];
-    snprintf(filename, sizeof(filename), "%s/hras_n%d.dot", out_dir, n);
-    FILE *f = fopen(filename, "w");
-    if (f) {
-      for (int i = 0; i < hra_collection->count; i++) {
-        write_graph_dot(&hra_collection->graphs[i], f, i + 1, n);
-        if (i < hra_collection->count - 1) {
-          fprintf(f, "\n");
-        }
+  if (jobs > 1) {
+    ok = ok && parallel_regulatory(&run, jobs, verbose, &all_ras_count,
+                                   &hras_count, output_open ? &hra_out : NULL);
+    pthread_mutex_destroy(&run.lock);
+    pthread_cond_destroy(&run.task_done);
+    if (!ok)
+      printf("Parallel generation failed (out of memory or disk?)\n");
+  } else {
+    for (int i = 0; ok && i < topologies->count; i++) {
+      if (verbose && (i % 100 == 0 || i == topologies->count - 1)) {
+        printf("Processing topology %d/%d...\n", i + 1, topologies->count);
       }
-      fclose(f);
-      printf("HRA graphs written to %s\n", filename);
-    } else {
-      printf("Failed to open %s for writing\n", filename);
+      ok = generate_all_regulatory_from_topology(
+          &topologies->graphs[i], &all_ras_count, &hras_count,
+          output_open ? &hra_out : NULL);
     }
   }
 
-  clock_t end_time = clock();
-  double elapsed = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
+  if (output_open) {
+    if (hra_out.hrab)
+      hrab_close_writer(hra_out.hrab);
+    else
+      fclose(hra_out.dot);
+    if (hras_count > 0)
+      printf("HRA graphs written to %s\n", filename);
+    else
+      remove(filename);
+  }
+
+  double elapsed = wall_time_seconds() - start_time;
 
-  printf("\nResults for n=%d:\n", n);
+  printf("\nResults for n=%d%s:\n", n, ok ? "" : " (incomplete)");
   printf("  Canonical topologies: %d\n", topologies->count);
   printf("  Total regulatory architectures: %llu\n", all_ras_count);
   printf("  Heritable regulatory architectures (HRAs): %llu\n", hras_count);
-  printf("  Time: %.2f seconds\n", elapsed);
+  printf("  Time: %.2f seconds", elapsed);
+  if (jobs > 1)
+    printf(" (%d threads)", jobs);
+  printf("\n");
+  printf("  Peak memory: %.1f MB\n", peak_rss_mb());
 
   // Cleanup
-  free(seen_reps);
-  free(global_seen_reps);
-  free(hra_seen_reps);
   free_graph_collection(topologies);
-  free_graph_collection(hra_collection);
 }
 
 // Function that can be called to count HRAs by size
-void count_hras_by_size(void) {
+void count_hras_by_size(int jobs, bool count_only) {
   printf("Counting HRAs by network size...\n");
-  for (int n = 2; n <= 5; n++) {
-    generate_hras(n, false);
+  for (int n = 2; n <= (count_only ? COUNT_MAX_NODES : 5); n++) {
+    if (count_only)
+      count_hras(n);
+    else
+      generate_hras(n, false, false, jobs);
   }
 }
 
@@ -413,31 +1037,64 @@ void count_hras_by_size(void) {
 int main(int argc, char *argv[]) {
   int n = 3; // default value
   bool verbose = false;
+  bool binary = false;
+  bool count_only = false;
+  int jobs = 1;
+
+  // Options may appear anywhere; everything else is positional
+  const char *pos[2];
+  int n_pos = 0;
+  bool bad_args = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--hrab") == 0)
+      binary = true;
+    else if (strcmp(argv[i], "--count-only") == 0)
+      count_only = true;
+    else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+      jobs = atoi(argv[++i]);
+    else if (strncmp(argv[i], "-j", 2) == 0 && argv[i][2] != '\0')
+      jobs = atoi(argv[i] + 2);
+    else if (strcmp(argv[i], "-j") == 0)
+      bad_args = true;
+    else if (n_pos < 2)
+      pos[n_pos++] = argv[i];
+  }
+  if (jobs < 1 || jobs > MAX_JOBS)
+    bad_args = true;
 
   // Parse command line arguments
-  if (argc > 1) {
-    n = atoi(argv[1]);
-    if (n <= 0 || n > MAX_NODES) {
-      printf("Usage: %s [n] [verbose]\n", argv[0]);
-      printf("  n: number of nodes (1-%d), default=3\n", MAX_NODES);
-      printf("  verbose: any second argument enables verbose output\n");
-      return 1;
-    }
+  if (n_pos > 0) {
+    n = atoi(pos[0]);
+    if (n <= 0 || n > (count_only ? COUNT_MAX_NODES : MAX_NODES))
+      bad_args = true;
+  }
+  if (bad_args) {
+    printf("Usage: %s [--hrab] [--count-only] [-j threads] [n] [verbose]\n",
+           argv[0]);
+    printf("  n: number of nodes (1-%d), default=3\n", MAX_NODES);
+    printf("  verbose: any second argument enables verbose output\n");
+    printf("  --hrab: write hras_n<n>.hrab records instead of DOT\n");
+    printf("  --count-only: print the totals only, counted for n up to %d\n",
+           COUNT_MAX_NODES);
+    printf("  -j: worker threads (1-%d), default=1\n", MAX_JOBS);
+    return 1;
   }
 
-  if (argc > 2) {
+  if (n_pos > 1) {
     verbose = true;
   }
 
   printf("HRA Generator - Heritable Regulatory Architectures\n");
   printf("================================================\n");
 
-  if (argc == 1) {
-    // If no arguments, run for multiple sizes
-    count_hras_by_size();
+  if (n_pos == 0) {
+    // If no size given, run for multiple sizes
+    count_hras_by_size(jobs, count_only);
+  } else if (count_only) {
+    count_hras(n);
   } else {
     // Run for specific size
-    generate_hras(n, verbose);
+    generate_hras(n, verbose, binary, jobs);
   }
 
   return 0;
@@ -2,16 +2,24 @@
 #define HRA_TEST3_H
 
 #include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include "hra_binary.h"
+#include "hra_packed.h"
+
 #define MAX_NODES 10
 #define MAX_EDGES 90        // MAX_NODES * (MAX_NODES - 1)
 #define MAX_GRAPHS 10000000 // 10 million
 
+#if MAX_NODES > PACKED_MAX_NODES
+#error "MAX_NODES does not fit PackedGraph"
+#endif
+
 // Edge structure
 typedef struct {
   int from;
@@ -36,6 +44,63 @@ typedef struct {
   int capacity;
 } GraphCollection;
 
+// Automorphisms of a topology, as permutations of its edges. Pattern bit k
+// labels edge k; tables[a][b][x] is the image under automorphism a of the
+// pattern whose byte b is x, so a 32-edge pattern maps with four lookups.
+typedef struct {
+  int count; // non-identity automorphisms
+  unsigned int (*tables)[4][256];
+} LabelGroup;
+
+#define MAX_JOBS 64
+
+// Exact totals for --count-only. Intermediate sums reach about
+// 3^(n(n-1)), so without 128-bit integers only n <= 6 fits.
+#if defined(__SIZEOF_INT128__)
+typedef unsigned __int128 CountInt;
+#define COUNT_MAX_NODES 9
+#else
+typedef unsigned long long CountInt;
+#define COUNT_MAX_NODES 6
+#endif
+
+// Label patterns (bit i labels topology edge i black) of the HRAs found for
+// one topology, kept by -j workers until the topology's turn to be written
+typedef struct {
+  unsigned long long *patterns;
+  long long count;
+  long long capacity;
+} PatternList;
+
+// Destination for generated HRAs: DOT text, or .hrab records with --hrab.
+// When deferred is set, patterns are only recorded there.
+typedef struct {
+  FILE *dot;
+  HrabWriter *hrab;
+  unsigned long long written;
+  PatternList *deferred;
+} HraOutput;
+
+// Shared state of the -j thread pool. Tasks are handed out in order from
+// next_task, and results are merged in task order, so the output does not
+// depend on the thread count.
+typedef struct {
+  int n;
+  // Topology phase: one task per subtree of the orderly generation
+  PackedGraph *frontier;
+  int n_frontier;
+  unsigned long long search_nodes;
+  // Regulatory phase: one task per canonical topology
+  GraphCollection *topologies;
+  unsigned long long *ras_counts;
+  PatternList *hra_patterns;
+  bool *done;
+  int next_task;
+  bool failed;
+  pthread_mutex_t lock;
+  pthread_cond_t task_done;
+} ParallelRun;
+
 // Function declarations
 void init_graph(Graph *g, int n_nodes);
 void add_edge(Graph *g, int from, int to, int regulation);
@@ -43,21 +108,27 @@ bool is_weakly_connected(Graph *g);
 bool is_heritable_topology(Graph *g);
 bool is_heritable_regulatory(Graph *g);
 bool next_permutation(int *arr, int n);
-int generate_all_edges(int n, Edge *all_edges);
-void generate_edge_combinations(Edge *all_edges, int total_edges, int k,
-                                int start, Edge *current_combo, int combo_idx,
-                                GraphCollection *topologies, int n_nodes,
-                                int *seen_reps, long long *seen_count);
-void generate_all_regulatory_from_topology(
-    Graph *topology, unsigned long long *all_ras_count,
-    unsigned long long *hras_count, int *global_seen_reps,
-    long long *global_seen_count, int *hra_seen_reps, long long *hra_seen_count,
-    GraphCollection *hra_collection);
-void generate_hras(int n, bool verbose);
-void count_hras_by_size(void);
+int orderly_children(const PackedGraph *g, PackedGraph *children);
+bool generate_topologies(int n, GraphCollection *topologies,
+                         unsigned long long *search_nodes);
+void sort_topologies(GraphCollection *topologies);
+bool build_label_group(const Graph *topology, LabelGroup *lg);
+void free_label_group(LabelGroup *lg);
+bool is_orbit_representative(const LabelGroup *lg, unsigned int pat);
+bool generate_all_regulatory_from_topology(Graph *topology,
+                                           unsigned long long *all_ras_count,
+                                           unsigned long long *hras_count,
+                                           HraOutput *hra_out);
+void generate_hras(int n, bool verbose, bool binary, int jobs);
+void count_hras_by_size(int jobs, bool count_only);
+CountInt count_connected_graphs(int n, int states, int bad);
+void count_hras(int n);
 void compute_canonical_rep(Graph *g, int *canon);
+void graph_to_packed(const Graph *g, PackedGraph *pg);
 GraphCollection *create_graph_collection(void);
 void free_graph_collection(GraphCollection *gc);
 bool add_graph_to_collection(GraphCollection *gc, Graph *g);
+double peak_rss_mb(void);
+double wall_time_seconds(void);
 
 #endif // HRA_TEST3_H